@@ -0,0 +1,250 @@
+/*
+ *  Copyright (c) 2019-present, LBS Trading LLC. All rights reserved.
+ *  See the file LICENSE.md for licensing information.
+ */
+
+/*
+  Routing latency benchmark.
+
+  Drives a routable book with a stream of user takers sweeping MM quotes
+  posted for several simulated venues, and reports:
+
+  - taker end-to-end latency, from add() to the routing outcome of its
+    first plan being reported
+  - routing requests pending in the book, sampled on every arrival
+  - throughput of takers and routing requests
+
+  Arrivals are open loop: takers are submitted at a fixed rate whatever
+  the state of the book, so a slow venue shows up as pending requests
+  piling up rather than as a lower arrival rate.
+
+  usage: routing_bench [takers] [arrivals per sec] [median latency us]
+                       [fill ratio] [failure rate]
+*/
+
+#include <memory>
+#include <vector>
+#include <random>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include <unordered_map>
+
+#include <utils/ts.h>
+#include <utils/uint128.h>
+#include <book/ob.h>
+#include <book/tracker.h>
+#include <book/plugins/routable.h>
+#include <book/plugins/self_trade_policy.h>
+#include <fixtures/order.h>
+
+#include "simulated_venue.h"
+
+namespace routing_bench {
+
+using namespace utils;
+
+const uint32_t SYMBOL_ID = 1;
+const uint32_t USER_ID = 1;
+const uint32_t MM_USER_ID = 1000;
+const uint32_t VENUES = 4;
+const size_t QUOTES_PER_SIDE = 64;
+const double MID_PRICE = 10000;
+
+typedef fixtures::OrderWithUserID Order;
+typedef std::shared_ptr<Order> OrderPtr;
+
+typedef book::ComposeTracker<OrderPtr,
+  book::plugins::SelfTradePolicyTracker,
+  book::plugins::RoutableTracker> Tracker;
+
+typedef book::OB<
+  Tracker,
+  book::plugins::SelfTradePolicyPlugin<Tracker>,
+  book::plugins::RoutablePlugin<Tracker>
+> Book_;
+
+uint64_t now_ns() {
+  return utils::ts_ns();
+}
+
+class Book : public Book_ {
+public:
+  Book(const bench::VenueConfig& config) :
+    Book_(SYMBOL_ID), routing_requests(0), dropped_quotes(0)
+  {
+    for(uint32_t i = 0; i < VENUES; ++i) {
+      bench::VenueConfig venue_config = config;
+      venue_config.seed = config.seed + i;
+      venues_.emplace_back(venue_config);
+      register_market_maker(MM_USER_ID + i, i);
+    }
+  }
+
+  void submit_taker(const OrderPtr& order) {
+    submitted_ns_[order->order_id()] = now_ns();
+    add(order);
+  }
+
+  void poll_venues() {
+    uint64_t now = now_ns();
+
+    for(auto& venue : venues_) {
+      venue.poll(now,
+        [this](uint64_t id) { on_routing_success(id); },
+        [this](uint64_t id) { on_routing_failure(id); });
+    }
+  }
+
+  size_t venue_pending() const {
+    size_t pending = 0;
+    for(auto& venue : venues_) pending += venue.pending();
+    return pending;
+  }
+
+  const std::vector<bench::SimulatedVenue>& venues() const { return venues_; }
+
+  std::vector<uint64_t> latencies_ns;
+  uint64_t routing_requests;
+  uint64_t dropped_quotes;
+
+protected:
+  void on_routing_request(const RoutingRequest& request) {
+    ++routing_requests;
+    venues_[request.exchange_id].submit(request.request_id, now_ns());
+  }
+
+  void on_callbacks(const Callbacks& callbacks) {
+    uint64_t now = 0;
+
+    for(auto& cb : callbacks) {
+      if(cb.type == TypedCallback::cb_order_cancel &&
+        cb.reason == book::routing_failure &&
+        cb.order->user_id() >= MM_USER_ID) ++dropped_quotes;
+
+      /* the outcome of a routing plan is reported with external scope */
+      if(cb.scope != TypedCallback::CbScope::external_only) continue;
+      if(cb.type != TypedCallback::cb_trade &&
+        cb.type != TypedCallback::cb_order_cancel) continue;
+
+      auto it = submitted_ns_.find(cb.order->order_id());
+      if(it == submitted_ns_.end()) continue;
+
+      if(now == 0) now = now_ns();
+      latencies_ns.push_back(now - it->second);
+      submitted_ns_.erase(it);
+    }
+  }
+
+private:
+  std::vector<bench::SimulatedVenue> venues_;
+  std::unordered_map<uint128, uint64_t, uint128_hash> submitted_ns_;
+};
+
+uint64_t percentile(const std::vector<uint64_t>& sorted, double p) {
+  if(sorted.empty()) return 0;
+  size_t i = (size_t)(p * (sorted.size() - 1));
+  return sorted[i];
+}
+
+int run(int argc, char** argv) {
+  size_t takers = argc > 1 ? strtoul(argv[1], nullptr, 10) : 100000;
+  double arrival_rate = argc > 2 ? atof(argv[2]) : 50000;
+
+  bench::VenueConfig config;
+  if(argc > 3) config.latency_median_us = atof(argv[3]);
+  if(argc > 4) config.fill_ratio = atof(argv[4]);
+  if(argc > 5) config.failure_rate = atof(argv[5]);
+
+  Book book(config);
+  std::mt19937_64 rng(42);
+  std::uniform_int_distribution<int> side(0, 1);
+  std::uniform_int_distribution<int> levels(1, 8);
+  std::uniform_int_distribution<int> venue(0, VENUES - 1);
+
+  uint64_t next_id = 1;
+  auto make_order = [&](uint32_t user_id, bool is_bid, double price, double qty) {
+    OrderPtr order = std::make_shared<Order>(user_id, is_bid, price, qty, 0);
+    order->order_id((uint128){0, next_id++});
+    return order;
+  };
+
+  /* MM quotes are cancelled as they match, market makers repost them */
+  auto requote = [&]() {
+    for(size_t i = book.bids().size(); i < QUOTES_PER_SIDE; ++i)
+      book.add(make_order(MM_USER_ID + venue(rng), true,
+        MID_PRICE - 1 - (double)(rng() % QUOTES_PER_SIDE), 1.0));
+
+    for(size_t i = book.asks().size(); i < QUOTES_PER_SIDE; ++i)
+      book.add(make_order(MM_USER_ID + venue(rng), false,
+        MID_PRICE + 1 + (double)(rng() % QUOTES_PER_SIDE), 1.0));
+  };
+
+  const uint64_t interval_ns = (uint64_t)(1e9 / arrival_rate);
+  uint64_t pending_sum = 0;
+  size_t pending_max = 0;
+
+  uint64_t start_ns = now_ns();
+  uint64_t next_arrival_ns = start_ns;
+
+  for(size_t submitted = 0; submitted < takers; ) {
+    book.poll_venues();
+
+    if(now_ns() < next_arrival_ns) continue;
+    next_arrival_ns += interval_ns;
+
+    requote();
+
+    /* sweeps a few levels, crossing quotes of several venues */
+    bool is_bid = side(rng);
+    double qty = levels(rng);
+    book.submit_taker(make_order(USER_ID, is_bid,
+      is_bid ? MID_PRICE * 2 : 1, qty));
+    ++submitted;
+
+    size_t pending = book.pending_requests_size();
+    pending_sum += pending;
+    pending_max = std::max(pending_max, pending);
+  }
+
+  while(book.venue_pending() > 0)
+    book.poll_venues();
+
+  uint64_t elapsed_ns = now_ns() - start_ns;
+  double elapsed_s = elapsed_ns / 1e9;
+
+  std::vector<uint64_t> latencies = book.latencies_ns;
+  std::sort(latencies.begin(), latencies.end());
+
+  bench::VenueStats stats;
+  for(auto& v : book.venues()) {
+    stats.requests += v.stats().requests;
+    stats.fills += v.stats().fills;
+    stats.misses += v.stats().misses;
+    stats.failures += v.stats().failures;
+  }
+
+  printf("venues: %u, median latency %.0fus, fill ratio %.3f, failure rate %.3f\n",
+    VENUES, config.latency_median_us, config.fill_ratio, config.failure_rate);
+  printf("takers: %zu in %.3fs (%.0f/s), %zu routed\n",
+    takers, elapsed_s, takers / elapsed_s, latencies.size());
+  printf("routing requests: %llu (%.0f/s), %llu filled, %llu missed, %llu failed\n",
+    (unsigned long long)stats.requests, stats.requests / elapsed_s,
+    (unsigned long long)stats.fills, (unsigned long long)stats.misses,
+    (unsigned long long)stats.failures);
+  printf("pending requests: mean %.2f, max %zu, MM quotes dropped %llu\n",
+    takers ? (double)pending_sum / takers : 0.0, pending_max,
+    (unsigned long long)book.dropped_quotes);
+  printf("taker latency (us): p50 %.1f, p90 %.1f, p99 %.1f, p99.9 %.1f, max %.1f\n",
+    percentile(latencies, 0.5) / 1e3, percentile(latencies, 0.9) / 1e3,
+    percentile(latencies, 0.99) / 1e3, percentile(latencies, 0.999) / 1e3,
+    percentile(latencies, 1) / 1e3);
+
+  return 0;
+}
+
+}
+
+int main(int argc, char** argv) {
+  return routing_bench::run(argc, argv);
+}
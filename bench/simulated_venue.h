@@ -0,0 +1,138 @@
+/*
+ *  Copyright (c) 2019-present, LBS Trading LLC. All rights reserved.
+ *  See the file LICENSE.md for licensing information.
+ */
+
+/*
+  An in-process stand-in for an external exchange, answering the routing
+  requests of a RoutablePlugin.
+
+  Every request is answered once after a random latency, drawn from a
+  log-normal distribution (most requests come back close to the median,
+  a few take much longer) on top of a fixed floor. The outcome is:
+
+  - a failure, with probability `failure_rate` (venue rejected the request
+    or the connection dropped)
+  - otherwise a fill with probability `fill_ratio`. the routable plugin has
+    no partial fills: a request is either filled in full or not at all, so
+    a missed fill (the MM quote was gone on the venue) is reported as a
+    failure as well
+
+  The venue does not own a clock. Requests are timestamped by the caller
+  and answered by poll(), so the same venue can be driven in real time or
+  in simulated time.
+*/
+
+#pragma once
+
+#include <queue>
+#include <vector>
+#include <cmath>
+#include <random>
+#include <cstdint>
+
+namespace bench {
+
+struct VenueConfig {
+  VenueConfig() :
+    latency_floor_us(20),
+    latency_median_us(150),
+    latency_sigma(0.5),
+    fill_ratio(0.98),
+    failure_rate(0.01),
+    seed(1) {}
+
+  double latency_floor_us;
+  double latency_median_us; /* median of the random part */
+  double latency_sigma;     /* shape of the log-normal tail */
+  double fill_ratio;
+  double failure_rate;
+  uint32_t seed;
+};
+
+struct VenueStats {
+  VenueStats() : requests(0), fills(0), misses(0), failures(0) {}
+
+  uint64_t requests;
+  uint64_t fills;
+  uint64_t misses;
+  uint64_t failures;
+};
+
+class SimulatedVenue {
+public:
+  SimulatedVenue(const VenueConfig& config = VenueConfig()) :
+    config_(config),
+    rng_(config.seed),
+    latency_(std::log(config.latency_median_us), config.latency_sigma),
+    uniform_(0, 1) {}
+
+  void submit(uint64_t request_id, uint64_t now_ns) {
+    Response response;
+    response.request_id = request_id;
+    response.due_ns = now_ns + (uint64_t)(
+      (config_.latency_floor_us + latency_(rng_)) * 1000);
+
+    if(uniform_(rng_) < config_.failure_rate) {
+      response.filled = false;
+      ++stats_.failures;
+    }
+    else if(uniform_(rng_) < config_.fill_ratio) {
+      response.filled = true;
+      ++stats_.fills;
+    }
+    else {
+      response.filled = false;
+      ++stats_.misses;
+    }
+
+    ++stats_.requests;
+    responses_.push(response);
+  }
+
+  /* answers every request due at `now_ns`, earliest first.
+     `on_fill` and `on_failure` take the request id */
+  template <class OnFill, class OnFailure>
+  size_t poll(uint64_t now_ns, OnFill on_fill, OnFailure on_failure) {
+    size_t answered = 0;
+
+    while(!responses_.empty() && responses_.top().due_ns <= now_ns) {
+      Response response = responses_.top();
+      responses_.pop();
+
+      if(response.filled)
+        on_fill(response.request_id);
+      else
+        on_failure(response.request_id);
+
+      ++answered;
+    }
+
+    return answered;
+  }
+
+  size_t pending() const { return responses_.size(); }
+
+  const VenueStats& stats() const { return stats_; }
+
+private:
+  struct Response {
+    uint64_t request_id;
+    uint64_t due_ns;
+    bool filled;
+
+    bool operator>(const Response& other) const {
+      return due_ns > other.due_ns;
+    }
+  };
+
+  VenueConfig config_;
+  VenueStats stats_;
+  std::mt19937_64 rng_;
+  std::lognormal_distribution<double> latency_;
+  std::uniform_real_distribution<double> uniform_;
+  std::priority_queue<Response, std::vector<Response>,
+    std::greater<Response>> responses_;
+};
+
+}
@@ -25,7 +25,8 @@ static const std::vector<std::string> cbTypeStr = {
   "TRADE",
   "POSITION OPEN",
   "POSITION UPADTE",
-  "POSITION CLOSE"
+  "POSITION CLOSE",
+  "LEVEL FILL"
 };
 
 static const std::vector<std::string> cbScopeStr = {
@@ -37,6 +38,18 @@ static const std::vector<std::string> cbScopeStr = {
 
 template <typename OrderPtr, typename... Plugins> class OB;
 
+/*
+  A cb_level_fill callback stands for one cb_trade per maker, all at the
+  callback's price, each maker being filled entirely. The makers and their
+  fill qty are the `fills_count` entries starting at `fills_begin` in the
+  book's maker_fills(), which is valid until on_callbacks() returns.
+*/
+template <typename OrderPtr>
+struct MakerFill {
+  OrderPtr maker;
+  double qty;
+};
+
 template <typename OrderPtr>
 class Callback {
 public:
@@ -54,7 +67,8 @@ public:
     cb_trade,
     cb_position_open,
     cb_position_update,
-    cb_position_close
+    cb_position_close,
+    cb_level_fill /* a taker filling several makers of a level, see MakerFill */
   };
 
 
@@ -114,6 +128,16 @@ public:
     double maker_total_fill_qty,
     uint8_t fill_flags);
 
+  static Callback<OrderPtr> level_fill(
+    const OrderPtr& taker,
+    double fill_qty,
+    double price,
+    double taker_avg_price,
+    double taker_total_fill_qty,
+    uint8_t fill_flags,
+    uint32_t fills_begin,
+    uint32_t fills_count);
+
   static Callback<OrderPtr> cancel(
     const OrderPtr& order,
     double current_qty_on_book, /* used for depth */
@@ -128,6 +152,16 @@ public:
     double filled_qty,
     double avg_price);
 
+  /* a cb_order_replace moving the order to `new_price`. the price of
+     plain replaces is 0, their price being unchanged */
+  static Callback<OrderPtr> amend(
+    const OrderPtr& order,
+    double new_price,
+    double effective_delta,
+    double current_qty_on_book,
+    double filled_qty,
+    double avg_price);
+
   static Callback<OrderPtr> replace_reject(
     const OrderPtr& order,
     double filled_qty,
@@ -162,6 +196,7 @@ public:
   CbType type;
   uint8_t flags;
   uint8_t reason;
+  uint32_t fills_begin; /* cb_level_fill only */
   OrderPtr order;
   OrderPtr maker_order;
   double qty;
@@ -172,6 +207,8 @@ public:
   double generic_3;
   uint64_t user_id;
   CbScope scope;
+  uint32_t fills_count; /* cb_level_fill only */
+  uint64_t ts; /* utils::ts_ns() when emitted */
 };
 
 template <class OrderPtr>
@@ -179,6 +216,7 @@ Callback<OrderPtr>::Callback()
 : type(cb_unknown),
   flags(0),
   reason(0),
+  fills_begin(0),
   order(nullptr),
   maker_order(nullptr),
   qty(0),
@@ -188,7 +226,9 @@ Callback<OrderPtr>::Callback()
   generic_2(0),
   generic_3(0),
   user_id(0),
-  scope(broadcast_to_all) { }
+  scope(broadcast_to_all),
+  fills_count(0),
+  ts(0) { }
 
 template <class OrderPtr>
 Callback<OrderPtr> Callback<OrderPtr>::accept(
@@ -241,6 +281,31 @@ Callback<OrderPtr> Callback<OrderPtr>::fill(
   return cb;
 }
 
+template <class OrderPtr>
+Callback<OrderPtr> Callback<OrderPtr>::level_fill(
+  const OrderPtr& taker,
+  double fill_qty,
+  double price,
+  double taker_avg_price,
+  double taker_total_fill_qty,
+  uint8_t fill_flags,
+  uint32_t fills_begin,
+  uint32_t fills_count)
+{
+  Callback<OrderPtr> cb;
+  cb.type = cb_level_fill;
+  cb.order = taker;
+  cb.qty = fill_qty;
+  cb.price = price;
+  cb.avg_price = taker_avg_price;
+  cb.generic_1 = price; /* makers' avg price */
+  cb.generic_2 = taker_total_fill_qty;
+  cb.flags = fill_flags;
+  cb.fills_begin = fills_begin;
+  cb.fills_count = fills_count;
+  return cb;
+}
+
 template <class OrderPtr>
 Callback<OrderPtr> Callback<OrderPtr>::cancel(
   const OrderPtr& order,
@@ -277,6 +342,21 @@ Callback<OrderPtr> Callback<OrderPtr>::replace(
   return cb;
 }
 
+template <class OrderPtr>
+Callback<OrderPtr> Callback<OrderPtr>::amend(
+  const OrderPtr& order,
+  double new_price,
+  double effective_delta,
+  double current_qty_on_book,
+  double filled_qty,
+  double avg_price)
+{
+  Callback<OrderPtr> cb = replace(
+    order, effective_delta, current_qty_on_book, filled_qty, avg_price);
+  cb.price = new_price;
+  return cb;
+}
+
 
 template <class OrderPtr>
 Callback<OrderPtr> Callback<OrderPtr>::cancel_reject(
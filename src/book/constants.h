@@ -26,4 +26,16 @@ const double MAKER_FEE_RATE = 0.005;
 
 const size_t DEFAULT_DEPTH_SIZE = 30;
 
+/* routing requests awaiting a response, per book */
+const size_t ROUTING_MAX_PENDING_REQUESTS = 256;
+
+/* MM fills a single routing plan can carry */
+const size_t ROUTING_MAX_REQUEST_FILLS = 16;
+
+/* exchanges a single routing plan can span */
+const size_t ROUTING_MAX_LEGS = 8;
+
+/* consumers a CallbackDispatcher can fan out to */
+const size_t DISPATCHER_MAX_SUBSCRIBERS = 32;
+
 }
\ No newline at end of file
@@ -0,0 +1,112 @@
+/*
+ *  Copyright (c) 2019-present, LBS Trading LLC. All rights reserved.
+ *  See the file LICENSE.md for licensing information.
+ */
+
+/*
+  Fans a batch of callbacks out to the consumers that want them.
+
+  A subscriber gives an audience, the scopes it belongs to, and a mask
+  of callback types. With scopes as bits (internal_only = 1, external_only
+  = 2, broadcast_to_all = both, suppress_callback = none), the consumers
+  listed in routable.h subscribe as:
+
+  - hold updater:        internal | external (all but suppressed)
+  - depth:               internal
+  - callbacks publisher: external
+
+  Subscriptions are compiled into a table giving, for each (scope, type),
+  the set of subscribers. Dispatching looks a callback up once and appends
+  a pointer to it to the stream of each subscriber in the set. Streams
+  point into the book's callbacks: they are valid during the handler only,
+  as on_callbacks().
+*/
+
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <stdexcept>
+#include <functional>
+
+#include <book/constants.h>
+#include <book/callback.h>
+
+namespace book {
+
+template <class OrderPtr>
+class CallbackDispatcher {
+public:
+  typedef Callback<OrderPtr> TypedCallback;
+  typedef typename TypedCallback::CbType CbType;
+  typedef typename TypedCallback::CbScope CbScope;
+  typedef std::vector<const TypedCallback*> Stream;
+  typedef std::function<void(const Stream&)> Handler;
+
+  enum Audience : uint8_t {
+    internal = TypedCallback::internal_only,
+    external = TypedCallback::external_only,
+    everyone = TypedCallback::broadcast_to_all
+  };
+
+  enum : uint64_t { all_types = UINT64_MAX };
+
+  static constexpr uint64_t type_bit(CbType type) {
+    return 1ull << type;
+  }
+
+  CallbackDispatcher() : routes_() {}
+
+  /* returns the subscriber's index */
+  size_t subscribe(Audience audience, uint64_t types, Handler handler) {
+    if(subscribers_.size() == DISPATCHER_MAX_SUBSCRIBERS)
+      throw std::runtime_error("Too many callback subscribers");
+
+    const uint32_t bit = 1u << subscribers_.size();
+    subscribers_.push_back(Subscriber{ std::move(handler), Stream() });
+
+    for(uint8_t scope = 0; scope < SCOPES; ++scope) {
+      if(!(scope & audience)) continue;
+
+      for(uint8_t type = 0; type < TYPES; ++type)
+        if(types & (1ull << type)) routes_[scope][type] |= bit;
+    }
+
+    return subscribers_.size() - 1;
+  }
+
+  void dispatch(const std::vector<TypedCallback>& callbacks) {
+    for(auto& callback : callbacks) {
+      uint32_t route = routes_[callback.scope & (SCOPES - 1)][callback.type];
+
+      while(route) {
+        subscribers_[__builtin_ctz(route)].stream.push_back(&callback);
+        route &= route - 1;
+      }
+    }
+
+    for(auto& subscriber : subscribers_) {
+      if(subscriber.stream.empty()) continue;
+      subscriber.handler(subscriber.stream);
+      subscriber.stream.clear();
+    }
+  }
+
+private:
+  enum : uint8_t {
+    SCOPES = 4,
+    TYPES = TypedCallback::cb_level_fill + 1 /* the last type */
+  };
+
+  static_assert(TYPES <= 64, "callback types must fit a 64-bit mask");
+
+  struct Subscriber {
+    Handler handler;
+    Stream stream;
+  };
+
+  std::vector<Subscriber> subscribers_;
+  uint32_t routes_[SCOPES][TYPES]; /* subscriber bits */
+};
+
+}
@@ -0,0 +1,254 @@
+/*
+ *  Copyright (c) 2019-present, LBS Trading LLC. All rights reserved.
+ *  See the file LICENSE.md for licensing information.
+ */
+
+/*
+  Fixed-layout binary encoding of callbacks, SBE-style.
+
+  A message is a header, a fixed root block, then a repeating group:
+
+    MessageHeader     block_length, template_id, schema_id, version
+    ExecutionReport   root block, block_length bytes
+    GroupHeader       block_length, num_in_group
+    MakerFillEntry    num_in_group entries, block_length bytes each
+
+  Every callback type is one ExecutionReport, with the fields of Callback
+  (see callback.h for their meaning per type). Only cb_level_fill has
+  group entries, one per maker. All blocks are multiples of 8 bytes and
+  little-endian, so that an 8-byte aligned message is read in place.
+
+  Versioning: fields are only ever appended to a block, raising
+  SCHEMA_VERSION. Decoders skip blocks by the lengths on the wire, so
+  they read messages of any later version, ignoring the fields they
+  don't know.
+
+  ExecutionReportPublisher encodes straight into a utils::ShmRingWriter,
+  so reports reach local processes with no syscall and no intermediate
+  copy.
+*/
+
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstring>
+
+#include <book/order.h>
+#include <book/callback.h>
+#include <utils/shm_ring.h>
+
+namespace book {
+namespace sbe {
+
+enum : uint16_t {
+  SCHEMA_ID = 1,
+  SCHEMA_VERSION = 1,
+  EXECUTION_REPORT_ID = 1
+};
+
+struct MessageHeader {
+  uint16_t block_length;
+  uint16_t template_id;
+  uint16_t schema_id;
+  uint16_t version;
+};
+
+struct ExecutionReport {
+  uint64_t ts;
+  uint64_t order_id_hi;
+  uint64_t order_id_lo;
+  uint64_t maker_order_id_hi; /* 0 unless a trade */
+  uint64_t maker_order_id_lo;
+  uint64_t user_id;
+  double qty;
+  double price;
+  double avg_price;
+  double generic_1;
+  double generic_2;
+  double generic_3;
+  uint32_t symbol_id;
+  uint8_t type;  /* Callback::CbType */
+  uint8_t flags;
+  uint8_t reason;
+  uint8_t scope;
+};
+
+struct GroupHeader {
+  uint16_t block_length;
+  uint16_t reserved;
+  uint32_t num_in_group;
+};
+
+struct MakerFillEntry {
+  uint64_t order_id_hi;
+  uint64_t order_id_lo;
+  double qty;
+};
+
+static_assert(sizeof(MessageHeader) == 8, "SBE header layout");
+static_assert(sizeof(ExecutionReport) == 104, "SBE root block layout");
+static_assert(sizeof(GroupHeader) == 8, "SBE group header layout");
+static_assert(sizeof(MakerFillEntry) == 24, "SBE group entry layout");
+
+
+template <class OrderPtr>
+size_t encoded_length(const Callback<OrderPtr>& cb) {
+  size_t fills = cb.type == Callback<OrderPtr>::cb_level_fill ? cb.fills_count : 0;
+  return sizeof(MessageHeader) + sizeof(ExecutionReport) +
+    sizeof(GroupHeader) + fills * sizeof(MakerFillEntry);
+}
+
+/* writes encoded_length(cb) bytes to `out`. `maker_fills` is the book's
+   maker_fills(), read for cb_level_fill only */
+template <class OrderPtr>
+size_t encode(
+  char* out,
+  uint32_t symbol_id,
+  const Callback<OrderPtr>& cb,
+  const MakerFill<OrderPtr>* maker_fills)
+{
+  static_assert(order_has_order_id<OrderPtr>::value,
+    "execution reports require orders to provide order_id()");
+
+  MessageHeader* header = reinterpret_cast<MessageHeader*>(out);
+  header->block_length = sizeof(ExecutionReport);
+  header->template_id = EXECUTION_REPORT_ID;
+  header->schema_id = SCHEMA_ID;
+  header->version = SCHEMA_VERSION;
+
+  ExecutionReport* report = reinterpret_cast<ExecutionReport*>(header + 1);
+  report->ts = cb.ts;
+
+  if(cb.order) {
+    report->order_id_hi = cb.order->order_id().hi;
+    report->order_id_lo = cb.order->order_id().lo;
+  } else {
+    report->order_id_hi = report->order_id_lo = 0;
+  }
+
+  if(cb.maker_order) {
+    report->maker_order_id_hi = cb.maker_order->order_id().hi;
+    report->maker_order_id_lo = cb.maker_order->order_id().lo;
+  } else {
+    report->maker_order_id_hi = report->maker_order_id_lo = 0;
+  }
+
+  report->user_id = cb.user_id;
+  report->qty = cb.qty;
+  report->price = cb.price;
+  report->avg_price = cb.avg_price;
+  report->generic_1 = cb.generic_1;
+  report->generic_2 = cb.generic_2;
+  report->generic_3 = cb.generic_3;
+  report->symbol_id = symbol_id;
+  report->type = cb.type;
+  report->flags = cb.flags;
+  report->reason = cb.reason;
+  report->scope = cb.scope;
+
+  GroupHeader* group = reinterpret_cast<GroupHeader*>(report + 1);
+  group->block_length = sizeof(MakerFillEntry);
+  group->reserved = 0;
+  group->num_in_group = 0;
+
+  MakerFillEntry* entry = reinterpret_cast<MakerFillEntry*>(group + 1);
+
+  if(cb.type == Callback<OrderPtr>::cb_level_fill) {
+    group->num_in_group = cb.fills_count;
+
+    for(uint32_t i = 0; i < cb.fills_count; ++i, ++entry) {
+      const MakerFill<OrderPtr>& fill = maker_fills[cb.fills_begin + i];
+      entry->order_id_hi = fill.maker->order_id().hi;
+      entry->order_id_lo = fill.maker->order_id().lo;
+      entry->qty = fill.qty;
+    }
+  }
+
+  return reinterpret_cast<char*>(entry) - out;
+}
+
+
+/* reads a message in place */
+class ExecutionReportDecoder {
+public:
+  ExecutionReportDecoder() : header_(nullptr), report_(nullptr), group_(nullptr) {}
+
+  /* returns false if `data` is not a complete execution report */
+  bool wrap(const char* data, size_t length) {
+    header_ = reinterpret_cast<const MessageHeader*>(data);
+
+    if(length < sizeof(MessageHeader) ||
+      header_->schema_id != SCHEMA_ID ||
+      header_->template_id != EXECUTION_REPORT_ID ||
+      header_->block_length < sizeof(ExecutionReport))
+      return false;
+
+    const char* group = data + sizeof(MessageHeader) + header_->block_length;
+    if(group + sizeof(GroupHeader) > data + length)
+      return false;
+
+    report_ = reinterpret_cast<const ExecutionReport*>(header_ + 1);
+    group_ = reinterpret_cast<const GroupHeader*>(group);
+
+    return group_->block_length >= sizeof(MakerFillEntry) &&
+      group + sizeof(GroupHeader) +
+        (size_t)group_->num_in_group * group_->block_length <= data + length;
+  }
+
+  const MessageHeader& header() const { return *header_; }
+  const ExecutionReport& report() const { return *report_; }
+
+  uint32_t maker_fills_count() const { return group_->num_in_group; }
+
+  const MakerFillEntry& maker_fill(uint32_t i) const {
+    return *reinterpret_cast<const MakerFillEntry*>(
+      reinterpret_cast<const char*>(group_ + 1) + (size_t)i * group_->block_length);
+  }
+
+private:
+  const MessageHeader* header_;
+  const ExecutionReport* report_;
+  const GroupHeader* group_;
+};
+
+
+/* encodes callbacks for external consumers (external_only and
+   broadcast_to_all) into a shared-memory ring, one frame per callback */
+template <class OrderPtr>
+class ExecutionReportPublisher {
+public:
+  typedef Callback<OrderPtr> TypedCallback;
+
+  ExecutionReportPublisher(utils::ShmRingWriter& ring, uint32_t symbol_id) :
+    ring_(ring), symbol_id_(symbol_id) {}
+
+  void publish(const TypedCallback& cb, const MakerFill<OrderPtr>* maker_fills) {
+    const size_t length = encoded_length(cb);
+    char* out = ring_.reserve(length);
+    ring_.commit(encode(out, symbol_id_, cb, maker_fills));
+  }
+
+  /* returns the number of reports published */
+  size_t publish(
+    const std::vector<TypedCallback>& callbacks,
+    const std::vector<MakerFill<OrderPtr>>& maker_fills)
+  {
+    size_t published = 0;
+
+    for(auto& cb : callbacks) {
+      if(!(cb.scope & TypedCallback::external_only)) continue;
+      publish(cb, maker_fills.data());
+      ++published;
+    }
+
+    return published;
+  }
+
+private:
+  utils::ShmRingWriter& ring_;
+  const uint32_t symbol_id_;
+};
+
+}
+}
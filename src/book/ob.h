@@ -10,8 +10,11 @@
 #include <cassert>
 #include <stdint.h>
 #include <memory>
+#include <iterator>
 #include <iostream>
 
+#include <utils/ts.h>
+
 #include "types.h"
 #include "book_price.h"
 #include "tracker.h"
@@ -37,14 +40,24 @@ public:
   typedef Callback<OrderPtr> TypedCallback;
   typedef std::vector<TypedCallback> Callbacks;
   typedef std::multimap<BookPrice, Tracker> TrackerMap;
+  typedef MakerFill<OrderPtr> TypedMakerFill;
+  typedef std::vector<TypedMakerFill> MakerFills;
 
   OB(uint32_t symbol_id);
 
   bool add(const OrderPtr& order);
   bool add_tracker(Tracker& taker);
 
+  void halt(CancelReasons reason = engine_shutdown);
+  void resume();
+  void resume(const std::vector<OrderPtr>& orders);
+  bool halted() const { return halted_; }
+
   void cancel(const OrderPtr& order, CancelReasons reason);
+  size_t cancel_range(bool is_bid, double min_price, double max_price,
+    CancelReasons reason = user_cancel);
   void replace(const OrderPtr& order, double delta);
+  void amend(const OrderPtr& order, const OrderPtr& amended);
   void set_market_price(double price);
 
   uint32_t symbol_id() const { return symbol_id_; }
@@ -53,6 +66,9 @@ public:
   const TrackerMap& bids() const { return bids_; }
   const TrackerMap& asks() const { return asks_; }
 
+  /* makers of the cb_level_fill callbacks being processed */
+  const MakerFills& maker_fills() const { return maker_fills_; }
+
 protected:
   /* for callbacks to be accessed from plugins */
   Callbacks& callbacks() { return callbacks_; };
@@ -61,14 +77,31 @@ protected:
     Tracker& taker,
     TrackerMap& makers);
 
+  double fill_level(
+    Tracker& taker,
+    TrackerMap& makers,
+    typename TrackerMap::iterator& pos,
+    double taker_qty);
+
   double trade(
     Tracker& taker,
     Tracker& maker);
 
+  double trade(
+    Tracker& taker,
+    Tracker& maker,
+    double taker_qty);
+
   bool find(
     const OrderPtr& order,
     typename TrackerMap::iterator& it);
 
+  void erase_tracker(
+    TrackerMap& trackers,
+    typename TrackerMap::iterator it);
+
+  bool do_add(const OrderPtr& order, bool& matched);
+
   void emit_callback(const TypedCallback& callback);
   void emit_cancel_callback(
     const Tracker& tracker, CancelReasons reason);
@@ -76,7 +109,10 @@ protected:
   void process_callbacks();
 
   void do_cancel(const OrderPtr& order, CancelReasons reason);
-  void do_replace(const OrderPtr& order, double delta);
+  bool do_cancel(const typename TrackerMap::iterator& it, CancelReasons reason);
+  bool do_replace(const OrderPtr& order, double delta);
+  bool do_replace(const typename TrackerMap::iterator& it, double delta);
+  bool do_amend(const OrderPtr& order, const OrderPtr& amended);
   void replace_to_qty(const OrderPtr& order, double new_open_qty);
 
   virtual void on_callbacks(const Callbacks& callbacks) = 0;
@@ -87,7 +123,10 @@ private:
   TrackerMap bids_;
   TrackerMap asks_;
   Callbacks callbacks_;
+  MakerFills maker_fills_;
   bool is_taker_cancelled_;
+  bool halted_;
+  CancelReasons halt_reason_;
 };
 
 
@@ -95,9 +134,12 @@ template <class Tracker, class... Plugins>
 OB<Tracker, Plugins...>::OB(uint32_t symbol_id) :
   symbol_id_(symbol_id),
   market_price_(0),
-  is_taker_cancelled_(false)
+  is_taker_cancelled_(false),
+  halted_(false),
+  halt_reason_(engine_shutdown)
 {
   callbacks_.reserve(20);
+  maker_fills_.reserve(64);
 }
 
 template <class Tracker, class... Plugins>
@@ -109,8 +151,30 @@ void OB<Tracker, Plugins...>::set_market_price(double price) {
 
 template <class Tracker, class... Plugins>
 bool OB<Tracker, Plugins...>::add(const OrderPtr& order) {
+  bool matched = false;
+
+  if(do_add(order, matched))
+    emit_callback(TypedCallback::book_update());
+
+  process_callbacks();
+  return matched;
+}
+
+/**
+ * \brief adds an order, leaving the book update and the processing of
+ *  callbacks to the caller
+ * \return false if the order was rejected
+ */
+
+template <class Tracker, class... Plugins>
+bool OB<Tracker, Plugins...>::do_add(const OrderPtr& order, bool& matched) {
   assert(order->qty() != 0 || order->funds() != 0);
 
+  if(halted_) {
+    emit_callback(TypedCallback::reject(order, book_halted));
+    return false;
+  }
+
   Tracker taker(order);
 
   InsertRejectReasons reject_reason = dont_reject;
@@ -118,7 +182,6 @@ bool OB<Tracker, Plugins...>::add(const OrderPtr& order) {
 
   if(reject_reason != dont_reject) {
     emit_callback(TypedCallback::reject(order, reject_reason));
-    process_callbacks();
     return false;
   }
 
@@ -128,15 +191,63 @@ bool OB<Tracker, Plugins...>::add(const OrderPtr& order) {
   
   bool should_add_tracker_value = TRUE_FOR_ALL_PLUGINS(should_add_tracker(taker));
 
-  bool matched = should_add_tracker_value && add_tracker(taker);
+  matched = should_add_tracker_value && add_tracker(taker);
 
   callbacks_[accept_cb_index].qty = taker.filled_qty();
   callbacks_[accept_cb_index].avg_price = taker.avg_price();
 
+  return true;
+}
+
+
+/**
+ * \brief cancels every resting order and stops accepting orders until
+ *  resume(). the book is drained in one pass: one cancel callback per
+ *  order, then plugins drop their state at once (see
+ *  Plugin::on_halt()), and a single book update
+ */
+
+template <class Tracker, class... Plugins>
+void OB<Tracker, Plugins...>::halt(CancelReasons reason) {
+  halted_ = true;
+  halt_reason_ = reason;
+
+  callbacks_.reserve(callbacks_.size() + bids_.size() + asks_.size() + 1);
+
+  for(auto& entry : bids_) emit_cancel_callback(entry.second, reason);
+  for(auto& entry : asks_) emit_cancel_callback(entry.second, reason);
+
+  INVOKE_PLUGIN_HOOKS(on_halt(reason))
+
+  bids_.clear();
+  asks_.clear();
+
   emit_callback(TypedCallback::book_update());
   process_callbacks();
+}
 
-  return matched;
+template <class Tracker, class... Plugins>
+void OB<Tracker, Plugins...>::resume() {
+  halted_ = false;
+}
+
+/**
+ * \brief resumes trading and adds `orders` (typically the ones cancelled
+ *  by halt()) as one batch, followed by a single book update
+ */
+
+template <class Tracker, class... Plugins>
+void OB<Tracker, Plugins...>::resume(const std::vector<OrderPtr>& orders) {
+  halted_ = false;
+
+  callbacks_.reserve(callbacks_.size() + 2 * orders.size() + 1);
+
+  bool matched;
+  for(auto& order : orders)
+    do_add(order, matched);
+
+  emit_callback(TypedCallback::book_update());
+  process_callbacks();
 }
 
 
@@ -147,6 +258,15 @@ bool OB<Tracker, Plugins...>::add_tracker(Tracker& taker) {
   TrackerMap& takers = taker.is_bid() ? bids_ : asks_;
   TrackerMap& makers = taker.is_bid() ? asks_ : bids_;
 
+  /* plugins may add trackers they held back (stops, routed takers)
+     after the book was halted */
+  if(halted_) {
+    emit_callback(TypedCallback::cancel(
+      taker.ptr(), 0, taker.filled_qty(), taker.avg_price(), halt_reason_));
+    INVOKE_PLUGIN_HOOKS(after_add_tracker(taker))
+    return false;
+  }
+
   matched = match(taker, makers);
 
   if(!taker.filled() && !is_taker_cancelled_) {
@@ -161,6 +281,7 @@ bool OB<Tracker, Plugins...>::add_tracker(Tracker& taker) {
       auto it = takers.emplace(std::make_pair(
         BookPrice(taker.is_bid(), taker.price()), std::move(taker)));
 
+      INVOKE_PLUGIN_HOOKS(after_insert_tracker(it))
       INVOKE_PLUGIN_HOOKS(after_add_tracker(it->second))
     }
   } else {
@@ -185,24 +306,67 @@ bool OB<Tracker, Plugins...>::match(
 {
   bool matched = false;
   auto pos = makers.begin(); 
+
+  /* for funds-limited takers, the qty the remaining funds can buy is
+     worked out once per price level, then spent maker by maker. only the
+     last maker filled at a level may get a rounded-down partial fill, of
+     what the funds left can buy: the costs of the makers before it, each
+     rounded, may add up to more than level_qty did */
+  const bool funds_limited = taker.funds_limited();
+  double level_price = 0;
+  double level_qty = 0;
+
+  /* unless a plugin has to see every maker, the makers the taker fills
+     entirely are filled a level at a time, see fill_level() */
+  const bool fill_levels = TRUE_FOR_ALL_PLUGINS(should_fill_level(taker));
+  double filled_level_price = 0;
   
   while(pos != makers.end() && !taker.filled()) {
-    auto entry = pos++;
+    auto entry = pos;
 
     const BookPrice& maker_book_price = entry->first;
     if(!maker_book_price.matches(taker.price())) break;
 
     Tracker& maker = entry->second;
 
+    if(funds_limited) {
+      if(maker.price() != level_price) {
+        level_price = maker.price();
+        level_qty = taker.tradable_qty(level_price);
+      }
+
+      /* funds left can't buy an increment at this price */
+      if(level_qty <= 0) {
+        pos = makers.upper_bound(maker_book_price);
+        continue;
+      }
+    }
+
+    if(fill_levels && maker.price() != filled_level_price) {
+      filled_level_price = maker.price();
+
+      double traded = fill_level(taker, makers, pos,
+        funds_limited ? level_qty : taker.tradable_qty(filled_level_price));
+
+      if(traded > 0) {
+        matched = true;
+        level_qty -= traded;
+        continue;
+      }
+    }
+
     CancelReasons taker_reason = dont_cancel,
                   maker_reason = dont_cancel;
     
     INVOKE_PLUGIN_HOOKS(should_trade(
       taker, maker, taker_reason, maker_reason))
 
+    /* plugins may cancel other resting orders from the hooks,
+       so the next maker is only looked up once they have run */
     if(maker_reason != dont_cancel) {
       emit_cancel_callback(maker, maker_reason);
-      makers.erase(entry);
+      pos = std::next(entry);
+      erase_tracker(makers, entry);
     }
 
     if(taker_reason != dont_cancel) {
@@ -214,13 +378,20 @@ bool OB<Tracker, Plugins...>::match(
     if(maker_reason != dont_cancel)
       continue;
     
-    double traded = trade(taker, maker);
+    if(funds_limited && level_price * std::min(level_qty, maker.tradable_qty(level_price)) +
+      taker.filled_cost() > taker.funds())
+      level_qty = taker.tradable_qty(level_price);
+
+    double traded = funds_limited ?
+      trade(taker, maker, level_qty) : trade(taker, maker);
+    pos = std::next(entry);
+    level_qty -= traded;
 
     if(traded > 0) {
       matched = true;
 
       if(maker.filled())
-        makers.erase(entry);
+        erase_tracker(makers, entry);
     }
   }
 
@@ -228,6 +399,79 @@ bool OB<Tracker, Plugins...>::match(
 }
 
 
+/**
+ * \brief fills, in one pass, the makers from `pos` on at the same
+ *  price level that `taker_qty` fills entirely, and reports them with a
+ *  single cb_level_fill. the taker is filled and the market price set
+ *  once for the level. does nothing unless two makers or more qualify,
+ *  a lone maker being cheaper to trade the usual way.
+ * \return the qty filled, `pos` is moved past the filled makers
+*/
+
+template <class Tracker, class... Plugins>
+double OB<Tracker, Plugins...>::fill_level(
+  Tracker& taker,
+  TrackerMap& makers,
+  typename TrackerMap::iterator& pos,
+  double taker_qty)
+{
+  const double xprice = pos->second.price();
+  assert(xprice > 0);
+
+  auto level_end = makers.upper_bound(pos->first);
+  auto fills_end = pos;
+  double fill_qty = 0;
+  double fill_cost = 0;
+  uint32_t fills_count = 0;
+
+  /* the costs of the makers, each rounded, may add up to more than
+     taker_qty costs: a funds-limited taker stops short of the maker that
+     would overspend its funds, which match() then trades on its own */
+  const bool funds_limited = taker.funds_limited();
+
+  for(; fills_end != level_end; ++fills_end, ++fills_count) {
+    const double maker_qty = fills_end->second.tradable_qty(xprice);
+    if(fill_qty + maker_qty > taker_qty) break;
+
+    if(funds_limited &&
+      fill_cost + maker_qty * xprice + taker.filled_cost() > taker.funds()) break;
+
+    fill_qty += maker_qty;
+    fill_cost += maker_qty * xprice;
+  }
+
+  if(fills_count < 2)
+    return 0;
+
+  const uint32_t fills_begin = maker_fills_.size();
+
+  while(pos != fills_end) {
+    auto entry = pos++;
+    Tracker& maker = entry->second;
+
+    const double maker_qty = maker.tradable_qty(xprice);
+    maker.fill(maker_qty, maker_qty * xprice);
+
+    maker_fills_.push_back(TypedMakerFill{ maker.ptr(), maker_qty });
+    erase_tracker(makers, entry);
+  }
+
+  taker.fill(fill_qty, fill_cost);
+
+  uint8_t fill_flags = TypedCallback::maker_filled;
+  if(taker.filled())
+    fill_flags |= TypedCallback::taker_filled;
+
+  emit_callback(TypedCallback::level_fill(
+    taker.ptr(), fill_qty, xprice, taker.avg_price(), taker.filled_qty(),
+    fill_flags, fills_begin, fills_count));
+
+  set_market_price(xprice);
+
+  return fill_qty;
+}
+
+
 /**
  * \brief attempts to generate a trade given two opposite
  *  orders. generates fill callbacks & updates trackers accordingly 
@@ -237,11 +481,26 @@ template <class Tracker, class... Plugins>
 double OB<Tracker, Plugins...>::trade(
   Tracker& taker,
   Tracker& maker)
+{
+  assert(maker.price() > 0);
+  return trade(taker, maker, taker.tradable_qty(maker.price()));
+}
+
+
+/**
+ * \brief same as above, with the qty the taker can trade at the
+ *  maker's price already known
+*/
+
+template <class Tracker, class... Plugins>
+double OB<Tracker, Plugins...>::trade(
+  Tracker& taker,
+  Tracker& maker,
+  double taker_qty)
 {
   double xprice = maker.price();
   assert(xprice > 0);
 
-  const double taker_qty = taker.tradable_qty(xprice);
   const double maker_qty = maker.tradable_qty(xprice);
 
   const double fill_qty = std::min(taker_qty, maker_qty);
@@ -278,16 +537,27 @@ double OB<Tracker, Plugins...>::trade(
 }
 
 
+template <class Tracker, class... Plugins>
+void OB<Tracker, Plugins...>::erase_tracker(
+  TrackerMap& trackers,
+  typename TrackerMap::iterator it)
+{
+  INVOKE_PLUGIN_HOOKS(before_erase_tracker(it))
+  trackers.erase(it);
+}
+
 template <class Tracker, class... Plugins>
 void OB<Tracker, Plugins...>::process_callbacks() {
   on_callbacks(callbacks_);
   callbacks_.clear();
+  maker_fills_.clear();
 }
 
 template <class Tracker, class... Plugins>
 void OB<Tracker, Plugins...>::emit_callback(const TypedCallback& callback)
 {
   callbacks_.push_back(callback);
+  callbacks_.back().ts = utils::ts_ns();
 }
 
 
@@ -295,7 +565,7 @@ template <class Tracker, class... Plugins>
 void OB<Tracker, Plugins...>::emit_cancel_callback(
   const Tracker& tracker, CancelReasons reason)
 {
-  callbacks_.push_back(TypedCallback::cancel(
+  emit_callback(TypedCallback::cancel(
     tracker.ptr(),
     tracker.qty_on_book(),
     tracker.filled_qty(),
@@ -313,6 +583,45 @@ void OB<Tracker, Plugins...>::cancel(
   process_callbacks();
 }
 
+/**
+ * \brief cancels all resting orders of a side priced within
+ *  [min_price, max_price], in one pass over the range. the cancel
+ *  callbacks are followed by a single book update, none if nothing was
+ *  cancelled
+ * \return the number of orders cancelled
+ */
+
+template <class Tracker, class... Plugins>
+size_t OB<Tracker, Plugins...>::cancel_range(
+  bool is_bid, double min_price, double max_price, CancelReasons reason)
+{
+  TrackerMap& trackers = is_bid ? bids_ : asks_;
+  size_t cancelled = 0;
+
+  /* no order rests at a price of 0 or less. price 0 sorts first
+     on both sides, and would select the whole side */
+  if(min_price <= max_price && max_price > 0) {
+    /* best prices first: bids from max_price down, asks from min_price up */
+    auto it = trackers.lower_bound(BookPrice(is_bid, is_bid ? max_price : min_price));
+    auto last = is_bid && min_price <= 0 ? trackers.end() :
+      trackers.upper_bound(BookPrice(is_bid, is_bid ? min_price : max_price));
+
+    while(it != last) {
+      auto entry = it++;
+      emit_cancel_callback(entry->second, reason);
+      erase_tracker(trackers, entry);
+      ++cancelled;
+    }
+  }
+
+  if(cancelled > 0) {
+    emit_callback(TypedCallback::book_update());
+    process_callbacks();
+  }
+
+  return cancelled;
+}
+
 template <class Tracker, class... Plugins>
 void OB<Tracker, Plugins...>::do_cancel(
   const OrderPtr& order, CancelReasons reason)
@@ -330,7 +639,7 @@ void OB<Tracker, Plugins...>::do_cancel(
     if(tracker.filled()) return;
 
     emit_cancel_callback(tracker, reason);
-    trackers.erase(it);
+    erase_tracker(trackers, it);
   }
 
   else if(reason == user_cancel) {
@@ -339,38 +648,85 @@ void OB<Tracker, Plugins...>::do_cancel(
   }
 }
 
+/**
+ * \brief cancels a resting order given its position in the book,
+ *  for plugins that keep their own index of iterators
+ * \return false if the order was filled, and is left to match()
+ */
+
+template <class Tracker, class... Plugins>
+bool OB<Tracker, Plugins...>::do_cancel(
+  const typename TrackerMap::iterator& it, CancelReasons reason)
+{
+  Tracker& tracker = it->second;
+
+  /* same as above, a filled maker is erased by match() */
+  if(tracker.filled()) return false;
+
+  TrackerMap& trackers = tracker.is_bid() ? bids_ : asks_;
+  emit_cancel_callback(tracker, reason);
+  erase_tracker(trackers, it);
+  return true;
+}
+
 
 template <class Tracker, class... Plugins>
 void OB<Tracker, Plugins...>::replace(
   const OrderPtr& order, double delta)
 {
-  do_replace(order, delta);
+  if(do_replace(order, delta))
+    emit_callback(TypedCallback::book_update());
+
   process_callbacks();
 }
 
+/**
+ * \brief changes the open qty of a resting order in place, keeping its
+ *  priority, leaving the book update and the processing of callbacks to
+ *  the caller
+ * \return false if the replace was rejected
+ */
+
 template <class Tracker, class... Plugins>
-void OB<Tracker, Plugins...>::do_replace(
+bool OB<Tracker, Plugins...>::do_replace(
   const OrderPtr& order, double delta)
 {
   typename TrackerMap::iterator it;
 
-  if(!find(order, it))
-    return emit_callback(TypedCallback::replace_reject(
+  if(!find(order, it)) {
+    emit_callback(TypedCallback::replace_reject(
       order, 0, 0, replace_reject_not_found));
+    return false;
+  }
+
+  return do_replace(it, delta);
+}
 
+/**
+ * \brief same as above given the order's position in the book, for
+ *  plugins that keep their own index of iterators
+ */
+
+template <class Tracker, class... Plugins>
+bool OB<Tracker, Plugins...>::do_replace(
+  const typename TrackerMap::iterator& it, double delta)
+{
   Tracker& tracker = it->second;
 
   double open_qty = tracker.qty_on_book();
 
-  if(open_qty == 0)
-    return emit_callback(TypedCallback::replace_reject(
-      order, tracker.filled_qty(), tracker.avg_price(), replace_reject_no_qty));
+  if(open_qty == 0) {
+    emit_callback(TypedCallback::replace_reject(
+      tracker.ptr(), tracker.filled_qty(), tracker.avg_price(), replace_reject_no_qty));
+    return false;
+  }
 
   if(delta < 0 && -delta > open_qty) {
     delta = -open_qty;
   }
 
   tracker.change_open_qty(delta);
+  INVOKE_PLUGIN_HOOKS(after_replace_tracker(it))
 
   emit_callback(TypedCallback::replace(
     tracker.ptr(), delta, open_qty, tracker.filled_qty(), tracker.avg_price()));
@@ -378,10 +734,93 @@ void OB<Tracker, Plugins...>::do_replace(
   if(tracker.qty_on_book() < MIN_ORDER_QTY) {
     TrackerMap& trackers = tracker.is_bid() ? bids_ : asks_;
     emit_cancel_callback(tracker, replaced_all_qty);
-    trackers.erase(it);
+    erase_tracker(trackers, it);
   }
 
-  emit_callback(TypedCallback::book_update());
+  return true;
+}
+
+/**
+ * \brief moves a resting order to another price in one operation.
+ *  `amended` takes the place of `order` on the book: the same order, with
+ *  its new price and total qty. the order keeps its fills and loses its
+ *  priority, even at the same price (see replace() to change the qty in
+ *  place), and trades first if the new price crosses the book. plugins
+ *  check `amended` as they do new orders, a rejected amend leaving the
+ *  order as it was
+ */
+
+template <class Tracker, class... Plugins>
+void OB<Tracker, Plugins...>::amend(
+  const OrderPtr& order, const OrderPtr& amended)
+{
+  if(do_amend(order, amended))
+    emit_callback(TypedCallback::book_update());
+
+  process_callbacks();
+}
+
+/**
+ * \brief same as above, leaving the book update and the processing of
+ *  callbacks to the caller
+ * \return false if the amend was rejected
+ */
+
+template <class Tracker, class... Plugins>
+bool OB<Tracker, Plugins...>::do_amend(
+  const OrderPtr& order, const OrderPtr& amended)
+{
+  assert(order->is_bid() == amended->is_bid());
+
+  typename TrackerMap::iterator it;
+
+  if(!find(order, it)) {
+    emit_callback(TypedCallback::replace_reject(
+      order, 0, 0, replace_reject_not_found));
+    return false;
+  }
+
+  Tracker& tracker = it->second;
+
+  const double open_qty = tracker.qty_on_book();
+
+  if(amended->price() == 0) {
+    emit_callback(TypedCallback::replace_reject(
+      order, tracker.filled_qty(), tracker.avg_price(), replace_reject_invalid_price));
+    return false;
+  }
+
+  Tracker moved(amended);
+  moved.inherit(tracker);
+
+  /* amending down to the filled qty is a cancel */
+  if(open_qty == 0 || moved.filled()) {
+    emit_callback(TypedCallback::replace_reject(
+      order, tracker.filled_qty(), tracker.avg_price(), replace_reject_no_qty));
+    return false;
+  }
+
+  /* the amended order goes through the same checks as a new one, see
+     do_add(). a rejected amend leaves the order where it was */
+  InsertRejectReasons reject_reason = dont_reject;
+  INVOKE_PLUGIN_HOOKS(should_add(moved, reject_reason));
+
+  if(reject_reason != dont_reject) {
+    emit_callback(TypedCallback::replace_reject(
+      order, tracker.filled_qty(), tracker.avg_price(), replace_reject_not_allowed));
+    return false;
+  }
+
+  emit_callback(TypedCallback::amend(
+    order, amended->price(), moved.qty_on_book() - open_qty, open_qty,
+    tracker.filled_qty(), tracker.avg_price()));
+
+  erase_tracker(order->is_bid() ? bids_ : asks_, it);
+
+  if(TRUE_FOR_ALL_PLUGINS(should_add_tracker(moved)))
+    add_tracker(moved);
+
+  return true;
 }
 
 template <class Tracker, class... Plugins>
@@ -405,6 +844,7 @@ void OB<Tracker, Plugins...>::replace_to_qty(
   double delta = new_open_qty - open_qty;
 
   tracker.change_open_qty(delta);
+  INVOKE_PLUGIN_HOOKS(after_replace_tracker(it))
 
   emit_callback(TypedCallback::replace(
     tracker.ptr(), delta, open_qty, tracker.filled_qty(), tracker.avg_price()));
@@ -412,7 +852,7 @@ void OB<Tracker, Plugins...>::replace_to_qty(
   if(tracker.qty_on_book() < MIN_ORDER_QTY) {
     TrackerMap& trackers = tracker.is_bid() ? bids_ : asks_;
     emit_cancel_callback(tracker, replaced_all_qty);
-    trackers.erase(it);
+    erase_tracker(trackers, it);
   }
 
   emit_callback(TypedCallback::book_update());
@@ -3,18 +3,60 @@
  *  See the file LICENSE.md for licensing information.
  */
 
+/*
+  Orders are compile-time interfaces, not base classes.
+
+  The book is given orders through an OrderPtr, any pointer-like type
+  (a raw pointer, a std::shared_ptr, ...) whose pointee has the following
+  const member functions:
+
+    bool is_bid()
+    double qty()
+    double price()
+    double funds()
+
+  Plugins add their own requirements, e.g. user_id() and stp() for the self
+  trade policy, or order_id() for routing and execution reports. The book
+  reads them with direct calls that are inlined, so a decoded message
+  struct that provides inline accessors can be passed to the book as is,
+  without a wrapper object.
+
+  Requirements are checked with static_assert where trackers are built, so
+  a missing accessor is reported by name rather than deep in a template.
+*/
+
 #pragma once
 
+#include <utility>
+#include <type_traits>
+
 #include <book/types.h>
 
+/* order_has_NAME<OrderPtr>::value is true if `order->NAME()` is valid
+   on a const OrderPtr */
+#define BOOK_ORDER_REQUIREMENT(NAME) \
+  template <class OrderPtr, class = void> \
+  struct order_has_##NAME : std::false_type {}; \
+  template <class OrderPtr> \
+  struct order_has_##NAME<OrderPtr, decltype( \
+    (void) std::declval<const OrderPtr&>()->NAME())> : std::true_type {};
+
 namespace book {
 
-class Order {
-public:
-  virtual bool is_bid() const = 0;
-  virtual double qty() const = 0;
-  virtual double price() const = 0;
-  virtual double funds() const = 0;
-};
+BOOK_ORDER_REQUIREMENT(is_bid)
+BOOK_ORDER_REQUIREMENT(qty)
+BOOK_ORDER_REQUIREMENT(price)
+BOOK_ORDER_REQUIREMENT(funds)
+
+/* not required by the book. shared by the plugins identifying orders
+   outside of it, with an id with .hi and .lo such as utils::uint128 */
+BOOK_ORDER_REQUIREMENT(order_id)
+
+template <class OrderPtr>
+struct is_order : std::integral_constant<bool,
+  order_has_is_bid<OrderPtr>::value &&
+  order_has_qty<OrderPtr>::value &&
+  order_has_price<OrderPtr>::value &&
+  order_has_funds<OrderPtr>::value> {};
 
-}
\ No newline at end of file
+}
@@ -28,7 +28,12 @@ protected:
 
   virtual void cancel(const OrderPtr& order, CancelReasons reason) = 0;
   virtual void do_cancel(const OrderPtr& order, CancelReasons reason) = 0;
-  virtual void do_replace(const OrderPtr& order, double delta) = 0;
+  virtual bool do_cancel(
+    const typename TrackerMap::iterator& it, CancelReasons reason) = 0;
+  virtual bool do_replace(const OrderPtr& order, double delta) = 0;
+  virtual bool do_replace(
+    const typename TrackerMap::iterator& it, double delta) = 0;
+  virtual bool do_add(const OrderPtr& order, bool& matched) = 0;
   virtual bool add_tracker(Tracker& taker) = 0;
   virtual bool add(const OrderPtr& order) = 0;
   virtual double market_price() const = 0;
@@ -49,6 +54,28 @@ protected:
   virtual void after_add_tracker(
     const Tracker& taker) {}
 
+  /* the tracker was placed on the book. the iterator stays
+     valid until before_erase_tracker() is called for it */
+  virtual void after_insert_tracker(
+    const typename TrackerMap::iterator& it) {}
+
+  /* the tracker is about to leave the book (filled, cancelled
+     or replaced to zero) */
+  virtual void before_erase_tracker(
+    const typename TrackerMap::iterator& it) {}
+
+  /* the open qty of a resting tracker was changed by a replace. if
+     left with no qty, before_erase_tracker() follows */
+  virtual void after_replace_tracker(
+    const typename TrackerMap::iterator& it) {}
+
+  /* return false if makers matched by this taker must go through
+     should_trade() and after_trade() one by one. when all plugins
+     return true, makers the taker fills entirely are filled a level
+     at a time, and reported with a single cb_level_fill */
+  virtual bool should_fill_level(
+    const Tracker& taker) { return true; }
+
   virtual void should_trade(
     Tracker& taker,
     Tracker& maker,
@@ -66,6 +93,12 @@ protected:
     double prev_price,
     double new_price) {}
 
+  /* the book is halting: its resting orders are cancelled and dropped
+     all at once, without before_erase_tracker() being called for each.
+     plugins drop their indexes of them, and cancel the orders they
+     hold themselves with `reason` */
+  virtual void on_halt(CancelReasons reason) {}
+
 };
 
 }
\ No newline at end of file
@@ -0,0 +1,129 @@
+/*
+ *  Copyright (c) 2019-present, LBS Trading LLC. All rights reserved.
+ *  See the file LICENSE.md for licensing information.
+ */
+
+#pragma once
+
+#include <algorithm>
+
+#include <book/order.h>
+#include <book/plugin.h>
+#include <book/types.h>
+#include <utils/ts.h>
+#include <utils/timing_wheel.h>
+
+namespace book {
+namespace plugins {
+
+/* orders provide expire_at(): the time at which a resting order is
+ * cancelled (GTT/GTD, or end of day for day orders), in the clock passed
+ * to expire_orders(). 0 for good-till-cancelled orders */
+BOOK_ORDER_REQUIREMENT(expire_at)
+
+const uint64_t EXPIRY_TICK_NS = 1000000;
+
+template <class Base>
+struct ExpiryTracker : public Base {
+  typedef typename Base::OrderPtr OrderPtr;
+
+  static_assert(order_has_expire_at<OrderPtr>::value,
+    "expiry plugin requires orders to provide expire_at()");
+
+  ExpiryTracker(const OrderPtr& order) :
+    Base(order),
+    expire_at_(order->expire_at()),
+    expiry_timer_(utils::NULL_TIMER) {}
+
+  uint64_t expire_at() const { return expire_at_; }
+
+  /* handle of the order's timer while on the book */
+  utils::TimerId expiry_timer() const { return expiry_timer_; }
+  void expiry_timer(utils::TimerId timer) { expiry_timer_ = timer; }
+
+  private:
+    const uint64_t expire_at_;
+    utils::TimerId expiry_timer_;
+};
+
+
+/*
+  Cancels resting orders when they expire.
+
+  A timer is scheduled on a hierarchical timing wheel (see
+  utils::TimingWheel) when an order rests on the book, and cancelled when
+  it leaves it, filled or cancelled, both in O(1). expire_orders() is
+  driven by the caller's clock. The orders expiring by then are cancelled
+  as one batch, with a single book update. A limit spreads a large batch,
+  such as end-of-day expiry, over several calls.
+
+  The wheel starts at the time of the first expire_orders(), or else of
+  the first order scheduled: the wall clock, utils::wall_ns(), unless
+  the order expires earlier. Books driven by another clock, such as
+  replays, call expire_orders() with their start time first.
+*/
+
+template <class Tracker>
+class ExpiryPlugin : public Plugin<Tracker> {
+public:
+  typedef typename Plugin<Tracker>::TrackerMap TrackerMap;
+  typedef utils::TimingWheel<typename TrackerMap::iterator> Wheel;
+
+  ExpiryPlugin() : wheel_(EXPIRY_TICK_NS), started_(false) {}
+
+  /* return the number of orders cancelled */
+  size_t expire_orders(uint64_t now_ns, size_t limit = SIZE_MAX) {
+    started_ = true;
+
+    size_t expired = wheel_.advance(now_ns,
+      [this](const typename TrackerMap::iterator& it) {
+        it->second.expiry_timer(utils::NULL_TIMER);
+        this->do_cancel(it, order_expired);
+      }, limit);
+
+    if(expired > 0) {
+      this->emit_callback(TypedCallback::book_update());
+      this->process_callbacks();
+    }
+
+    return expired;
+  }
+
+  size_t expiring_orders_size() const { return wheel_.size(); }
+
+protected:
+  typedef Callback<typename Tracker::OrderPtr> TypedCallback;
+
+  void after_insert_tracker(const typename TrackerMap::iterator& it) {
+    Tracker& tracker = it->second;
+    if(tracker.expire_at() == 0) return;
+
+    /* from the wheel's start, 0, every order would wait in the overflow
+       list until the first expire_orders() */
+    if(!started_) {
+      wheel_.seed(std::min(utils::wall_ns(), tracker.expire_at()));
+      started_ = true;
+    }
+
+    tracker.expiry_timer(wheel_.schedule(tracker.expire_at(), it));
+  }
+
+  void before_erase_tracker(const typename TrackerMap::iterator& it) {
+    Tracker& tracker = it->second;
+    if(tracker.expiry_timer() != utils::NULL_TIMER) {
+      wheel_.cancel(tracker.expiry_timer());
+      tracker.expiry_timer(utils::NULL_TIMER);
+    }
+  }
+
+  void on_halt(CancelReasons reason) {
+    wheel_.clear();
+  }
+
+private:
+  Wheel wheel_;
+  bool started_;
+};
+
+}
+}
@@ -0,0 +1,118 @@
+/*
+ *  Copyright (c) 2019-present, LBS Trading LLC. All rights reserved.
+ *  See the file LICENSE.md for licensing information.
+ */
+
+#pragma once
+
+#include <book/plugin.h>
+#include <book/tracker.h>
+#include <utils/intrusive_user_list.h>
+
+#include <book/plugins/trackers/user_id_tracker.h>
+
+namespace book {
+namespace plugins {
+
+const uint32_t MASS_CANCEL_NULL_NODE = utils::NULL_USER_NODE;
+
+template <class Base>
+struct MassCancelTracker : public WithUserID<Base> {
+  typedef typename Base::OrderPtr OrderPtr;
+
+  MassCancelTracker(const OrderPtr& order) :
+    WithUserID<Base>(order),
+    mass_cancel_node_(MASS_CANCEL_NULL_NODE) {}
+
+  /* position in the plugin's per-user list while on the book */
+  uint32_t mass_cancel_node() const { return mass_cancel_node_; }
+  void mass_cancel_node(uint32_t node) { mass_cancel_node_ = node; }
+
+  private:
+    uint32_t mass_cancel_node_;
+};
+
+
+/*
+  Cancels all resting orders of a user, or of one side of a user, in
+  O(orders cancelled) (see OB::cancel_range() for a price range).
+
+  Resting orders are kept in intrusive per-user, per-side lists, linked
+  and unlinked in O(1) as they enter and leave the book. A mass cancel
+  walks the list, emits one cancel callback per order and a single book
+  update, and processes them as one batch.
+*/
+
+template <class Tracker>
+class MassCancelPlugin : public Plugin<Tracker> {
+public:
+  typedef typename Plugin<Tracker>::TrackerMap TrackerMap;
+
+  /* return the number of orders cancelled */
+  size_t cancel_user(uint64_t user_id, CancelReasons reason = user_cancel) {
+    /* cancelling may forget the user, read both heads first */
+    uint32_t bids_head = orders_.head(user_id, 0);
+    uint32_t asks_head = orders_.head(user_id, 1);
+
+    return finish(cancel_list(bids_head, reason) + cancel_list(asks_head, reason));
+  }
+
+  size_t cancel_user(uint64_t user_id, bool is_bid,
+    CancelReasons reason = user_cancel)
+  {
+    return finish(cancel_list(orders_.head(user_id, is_bid ? 0 : 1), reason));
+  }
+
+  /* number of the user's resting orders */
+  size_t user_orders_size(uint64_t user_id) const {
+    return orders_.size(user_id);
+  }
+
+protected:
+  typedef Callback<typename Tracker::OrderPtr> TypedCallback;
+
+  void after_insert_tracker(const typename TrackerMap::iterator& it) {
+    Tracker& tracker = it->second;
+    tracker.mass_cancel_node(
+      orders_.link(tracker.user_id(), it, tracker.is_bid() ? 0 : 1));
+  }
+
+  void before_erase_tracker(const typename TrackerMap::iterator& it) {
+    Tracker& tracker = it->second;
+    if(tracker.mass_cancel_node() != MASS_CANCEL_NULL_NODE) {
+      orders_.unlink(tracker.mass_cancel_node());
+      tracker.mass_cancel_node(MASS_CANCEL_NULL_NODE);
+    }
+  }
+
+  void on_halt(CancelReasons reason) {
+    orders_.clear();
+  }
+
+private:
+  /* bids, then asks of each user */
+  utils::IntrusiveUserList<typename TrackerMap::iterator, 2> orders_;
+
+  /* orders filled by a match in progress are left to it, uncounted */
+  size_t cancel_list(uint32_t node, CancelReasons reason) {
+    size_t cancelled = 0;
+
+    /* cancelling unlinks the node, so the next one is read beforehand */
+    while(node != MASS_CANCEL_NULL_NODE) {
+      uint32_t next = orders_.next(node);
+      if(this->do_cancel(orders_.value(node), reason)) ++cancelled;
+      node = next;
+    }
+
+    return cancelled;
+  }
+
+  size_t finish(size_t cancelled) {
+    this->emit_callback(TypedCallback::book_update());
+    this->process_callbacks();
+    return cancelled;
+  }
+};
+
+}
+}
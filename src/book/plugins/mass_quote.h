@@ -0,0 +1,262 @@
+/*
+ *  Copyright (c) 2019-present, LBS Trading LLC. All rights reserved.
+ *  See the file LICENSE.md for licensing information.
+ */
+
+#pragma once
+
+#include <cassert>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+#include <unordered_map>
+
+#include <book/plugin.h>
+#include <book/tracker.h>
+
+#include <book/plugins/trackers/user_id_tracker.h>
+
+namespace book {
+namespace plugins {
+
+template <class Base>
+struct MassQuoteTracker : public WithUserID<Base> {
+  typedef typename Base::OrderPtr OrderPtr;
+
+  MassQuoteTracker(const OrderPtr& order) :
+    WithUserID<Base>(order),
+    is_quote_(false) {}
+
+  /* placed by mass_quote(), and part of its user's ladder */
+  bool is_quote() const { return is_quote_; }
+  void is_quote(bool is_quote) { is_quote_ = is_quote; }
+
+  /* an amended quote stays in the ladder, at its new price */
+  void inherit(const MassQuoteTracker& amended) {
+    WithUserID<Base>::inherit(amended);
+    is_quote_ = amended.is_quote_;
+  }
+
+  private:
+    bool is_quote_;
+};
+
+
+/*
+  Replaces a market maker's quote ladder as a single unit.
+
+  mass_quote() is given the whole new ladder of a user, at most one quote
+  per side and price, and diffs it against the quotes of theirs still on
+  the book:
+
+  - a level left out of the ladder, or quoted with no qty, is cancelled
+  - a level whose qty drops is replaced in place, keeping its priority
+  - a level whose qty rises is cancelled, and the new quote added at the
+    back of the level
+  - a level whose qty is unchanged is left alone
+  - a new level is added
+
+  Cancels go first, so that new quotes don't trade against the ones they
+  replace. The changes are reported as one batch of callbacks, with a
+  single book update.
+
+  Each user's ladder is kept sorted by price, per side, and maintained as
+  quotes enter and leave the book. A quote moved with OB::amend() stays
+  in the ladder.
+*/
+
+template <class Tracker>
+class MassQuotePlugin : public Plugin<Tracker> {
+public:
+  typedef typename Tracker::OrderPtr OrderPtr;
+  typedef typename Plugin<Tracker>::TrackerMap TrackerMap;
+
+  MassQuotePlugin() : quoting_(nullptr), rises_(0) {}
+
+  /* `quotes` are new orders of `user_id`, with a price and qty (0 to
+     pull a level). returns the number of levels changed */
+  size_t mass_quote(uint64_t user_id, const std::vector<OrderPtr>& quotes) {
+    wanted_.assign(quotes.begin(), quotes.end());
+
+    std::sort(wanted_.begin(), wanted_.end(),
+      [](const OrderPtr& lhs, const OrderPtr& rhs) {
+        return lhs->is_bid() != rhs->is_bid() ?
+          lhs->is_bid() : lhs->price() < rhs->price();
+      });
+
+    for(size_t i = 0; i < wanted_.size(); ++i) {
+      if(wanted_[i]->user_id() != user_id || wanted_[i]->price() == 0)
+        throw std::invalid_argument("Quotes must be limit orders of the user");
+
+      if(i > 0 && wanted_[i]->is_bid() == wanted_[i - 1]->is_bid() &&
+        wanted_[i]->price() == wanted_[i - 1]->price())
+        throw std::invalid_argument("Quotes must be one per side and price");
+    }
+
+    /* a user without quotes has no ladder */
+    const Ladder none;
+    auto found = ladders_.find(user_id);
+    const Ladder& ladder = found == ladders_.end() ? none : found->second;
+
+    /* bids come first in wanted_ */
+    auto asks = std::find_if(wanted_.begin(), wanted_.end(),
+      [](const OrderPtr& order) { return !order->is_bid(); });
+
+    diff(ladder.side[0], wanted_.begin(), asks);
+    diff(ladder.side[1], asks, wanted_.end());
+
+    for(auto& it : cancels_)
+      this->do_cancel(it, user_cancel);
+
+    for(auto& reduce : reduces_)
+      this->do_replace(reduce.first, reduce.second);
+
+    bool matched;
+    for(auto& order : adds_) {
+      quoting_ = &order;
+      this->do_add(order, matched);
+    }
+    quoting_ = nullptr;
+
+    /* adds of a rising level were counted with its cancel */
+    size_t changed = cancels_.size() + reduces_.size() + adds_.size() - rises_;
+
+    cancels_.clear();
+    reduces_.clear();
+    adds_.clear();
+    wanted_.clear();
+    rises_ = 0;
+
+    this->emit_callback(TypedCallback::book_update());
+    this->process_callbacks();
+
+    return changed;
+  }
+
+  /* number of the user's quotes on the book */
+  size_t quotes_size(uint64_t user_id) const {
+    auto ladder = ladders_.find(user_id);
+    if(ladder == ladders_.end()) return 0;
+    return ladder->second.side[0].size() + ladder->second.side[1].size();
+  }
+
+  /* number of users with quotes on the book */
+  size_t quoting_users_size() const {
+    return ladders_.size();
+  }
+
+protected:
+  typedef Callback<OrderPtr> TypedCallback;
+
+  void after_insert_tracker(const typename TrackerMap::iterator& it) {
+    Tracker& tracker = it->second;
+
+    /* a quote being added, or amended. not an order the plugin may have
+       triggered while quoting */
+    if(!tracker.is_quote() && (!quoting_ || !(tracker.ptr() == *quoting_))) return;
+
+    tracker.is_quote(true);
+
+    Quotes& quotes = ladders_[tracker.user_id()].side[tracker.is_bid() ? 0 : 1];
+    quotes.insert(lower_bound(quotes, tracker.price()), Quote{ tracker.price(), it });
+  }
+
+  void before_erase_tracker(const typename TrackerMap::iterator& it) {
+    Tracker& tracker = it->second;
+    if(!tracker.is_quote()) return;
+
+    auto ladder = ladders_.find(tracker.user_id());
+    assert(ladder != ladders_.end());
+
+    Quotes& quotes = ladder->second.side[tracker.is_bid() ? 0 : 1];
+
+    /* an amend may have left two quotes at a price, until the next
+       mass_quote() cancels one */
+    auto quote = lower_bound(quotes, tracker.price());
+    while(quote != quotes.end() && quote->it != it) ++quote;
+
+    assert(quote != quotes.end());
+    if(quote == quotes.end()) return;
+
+    quotes.erase(quote);
+
+    /* users who stopped quoting are forgotten */
+    if(ladder->second.side[0].empty() && ladder->second.side[1].empty())
+      ladders_.erase(ladder);
+  }
+
+  void on_halt(CancelReasons reason) {
+    ladders_.clear();
+  }
+
+private:
+  struct Quote {
+    double price;
+    typename TrackerMap::iterator it;
+  };
+
+  typedef std::vector<Quote> Quotes;
+
+  /* sorted by price, bids then asks */
+  struct Ladder {
+    Quotes side[2];
+  };
+
+  std::unordered_map<uint64_t, Ladder> ladders_;
+  const OrderPtr* quoting_; /* the quote being added */
+
+  /* scratch space of mass_quote() */
+  std::vector<OrderPtr> wanted_;
+  std::vector<typename TrackerMap::iterator> cancels_;
+  std::vector<std::pair<typename TrackerMap::iterator, double>> reduces_;
+  std::vector<OrderPtr> adds_;
+  size_t rises_;
+
+  static typename Quotes::iterator lower_bound(Quotes& quotes, double price) {
+    return std::lower_bound(quotes.begin(), quotes.end(), price,
+      [](const Quote& quote, double rhs) { return quote.price < rhs; });
+  }
+
+  /* merges a side of the ladder with the wanted quotes, both sorted by
+     price, into the changes to make */
+  void diff(
+    const Quotes& quotes,
+    typename std::vector<OrderPtr>::const_iterator first,
+    typename std::vector<OrderPtr>::const_iterator last)
+  {
+    auto quote = quotes.begin();
+
+    while(quote != quotes.end() || first != last) {
+      if(first == last || (quote != quotes.end() && quote->price < (*first)->price())) {
+        cancels_.push_back((quote++)->it);
+        continue;
+      }
+
+      const OrderPtr& order = *first++;
+
+      if(quote == quotes.end() || order->price() < quote->price) {
+        if(order->qty() > 0) adds_.push_back(order);
+        continue;
+      }
+
+      const Quote& current = *quote++;
+      const Tracker& tracker = current.it->second;
+      const double open_qty = tracker.qty_on_book();
+
+      if(order->qty() <= 0)
+        cancels_.push_back(current.it);
+
+      else if(order->qty() < open_qty)
+        reduces_.push_back(std::make_pair(current.it, order->qty() - open_qty));
+
+      else if(order->qty() > open_qty) {
+        cancels_.push_back(current.it);
+        adds_.push_back(order);
+        ++rises_;
+      }
+    }
+  }
+};
+
+}
+}
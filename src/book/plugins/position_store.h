@@ -0,0 +1,153 @@
+/*
+ *  Copyright (c) 2019-present, LBS Trading LLC. All rights reserved.
+ *  See the file LICENSE.md for licensing information.
+ */
+
+/*
+  Open positions of a symbol, stored densely.
+
+  - positions live in a contiguous vector, one slot per user with an
+    open position. slots of closed positions are recycled
+  - user ids are mapped to slots with an open-addressing table
+    (linear probing, backward-shift deletion), kept at most half full.
+    a probe touches a single cache line in the common case
+
+  Memory is bounded by the peak number of simultaneously open positions,
+  not by the number of users that ever traded the symbol.
+*/
+
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+namespace book {
+namespace plugins {
+
+struct Position {
+  Position() : qty(0), base_price(0) {}
+
+  double qty;
+  double base_price;
+};
+
+class PositionStore {
+public:
+  enum : uint32_t { npos = UINT32_MAX };
+
+  PositionStore(size_t initial_capacity = 1024) : size_(0) {
+    size_t capacity = 16;
+    while(capacity < initial_capacity * 2) capacity <<= 1;
+    rehash(capacity);
+  }
+
+  /* returns the slot of the user's position, creating a flat one if needed.
+     slots remain valid until the position is released */
+  uint32_t acquire(uint64_t user_id) {
+    if((size_ + 1) * 2 > table_.size())
+      rehash(table_.size() * 2);
+
+    size_t i = probe(user_id);
+
+    if(table_[i].slot != npos)
+      return table_[i].slot;
+
+    uint32_t slot;
+
+    if(!free_slots_.empty()) {
+      slot = free_slots_.back();
+      free_slots_.pop_back();
+      positions_[slot] = Position();
+    } else {
+      slot = (uint32_t)positions_.size();
+      positions_.emplace_back();
+    }
+
+    table_[i].user_id = user_id;
+    table_[i].slot = slot;
+    ++size_;
+
+    return slot;
+  }
+
+  /* npos if the user has no position */
+  uint32_t find(uint64_t user_id) const {
+    return table_[probe(user_id)].slot;
+  }
+
+  Position& at(uint32_t slot) { return positions_[slot]; }
+  const Position& at(uint32_t slot) const { return positions_[slot]; }
+
+  void release(uint64_t user_id) {
+    size_t i = probe(user_id);
+    if(table_[i].slot == npos) return;
+
+    free_slots_.push_back(table_[i].slot);
+    --size_;
+
+    /* backward-shift deletion: pull back entries that would
+       become unreachable through the hole at i */
+    const size_t mask = table_.size() - 1;
+    size_t hole = i;
+
+    for(size_t j = (i + 1) & mask; table_[j].slot != npos; j = (j + 1) & mask) {
+      size_t home = bucket(table_[j].user_id);
+
+      /* entry at j can move to the hole if its home is not in (hole, j] */
+      if(((j - home) & mask) >= ((j - hole) & mask)) {
+        table_[hole] = table_[j];
+        hole = j;
+      }
+    }
+
+    table_[hole].slot = npos;
+  }
+
+  size_t size() const { return size_; }
+
+private:
+  struct Entry {
+    Entry() : user_id(0), slot(npos) {}
+
+    uint64_t user_id;
+    uint32_t slot;
+  };
+
+  std::vector<Entry> table_;
+  std::vector<Position> positions_;
+  std::vector<uint32_t> free_slots_;
+  size_t size_;
+  uint32_t shift_;
+
+  /* fibonacci hashing, top bits of the product */
+  size_t bucket(uint64_t user_id) const {
+    return (size_t)((user_id * 0x9E3779B97F4A7C15ull) >> shift_);
+  }
+
+  /* index of the user's entry, or of the empty entry ending its probe */
+  size_t probe(uint64_t user_id) const {
+    const size_t mask = table_.size() - 1;
+    size_t i = bucket(user_id);
+
+    while(table_[i].slot != npos && table_[i].user_id != user_id)
+      i = (i + 1) & mask;
+
+    return i;
+  }
+
+  void rehash(size_t capacity) {
+    std::vector<Entry> old;
+    old.swap(table_);
+    table_.resize(capacity);
+
+    shift_ = 64;
+    for(size_t c = capacity; c > 1; c >>= 1) --shift_;
+
+    for(auto& entry : old)
+      if(entry.slot != npos)
+        table_[probe(entry.user_id)] = entry;
+  }
+};
+
+}
+}
@@ -6,30 +6,23 @@
 #pragma once
 
 #include <iostream>
-#include <unordered_map>
 
 #include <book/plugin.h>
 #include <book/exceptions.h>
 #include <book/types.h>
 #include <book/callback.h>
 
+#include <book/plugins/position_store.h>
 #include <book/plugins/trackers/user_id_tracker.h>
 
 namespace book {
 namespace plugins {
 
-struct Position {
-  Position() : qty(0), base_price(0) {}
+template <class Base>
+struct PositionsTracker : public WithUserID<Base> {
+  typedef typename Base::OrderPtr OrderPtr;
 
-  double qty;
-  double base_price;
-};
-
-template <class OrderPtr>
-struct PositionsTracker : public virtual UserIDTracker<OrderPtr> {
-  PositionsTracker(const OrderPtr& order) {
-    UserIDTracker<OrderPtr>::set_user_id(order->user_id());
-  }
+  PositionsTracker(const OrderPtr& order) : WithUserID<Base>(order) {}
 };
 
 class PositionsInterface {
@@ -47,6 +40,9 @@ protected:
   typedef typename Tracker::OrderPtr OrderPtr;
   typedef Callback<OrderPtr> TypedCallback;
 
+  /* positions are updated on every maker's trade */
+  bool should_fill_level(const Tracker& taker) { return false; }
+
   void after_trade(
     Tracker& taker,
     Tracker& maker,
@@ -65,7 +61,7 @@ protected:
     uint64_t user_id, Position& position);
 
 private:
-  std::unordered_map<uint64_t, Position> positions_;
+  PositionStore positions_;
 };
 
 
@@ -80,11 +76,24 @@ void PositionsPlugin<Tracker>::after_trade(
   uint64_t taker_user_id = taker.user_id();
   uint64_t maker_user_id = maker.user_id();
 
-  Position& taker_pos = positions_[taker_user_id];
-  Position& maker_pos = positions_[maker_user_id];
+  /* acquire both slots before taking references, as
+     acquiring can grow the store */
+  uint32_t taker_slot = positions_.acquire(taker_user_id);
+  uint32_t maker_slot = positions_.acquire(maker_user_id);
+
+  Position& taker_pos = positions_.at(taker_slot);
+  Position& maker_pos = positions_.at(maker_slot);
 
   update_position(maker_pos, maker_user_id, maker_is_bid, qty, price);
   update_position(taker_pos, taker_user_id, !maker_is_bid, qty, price);
+
+  /* released only once both sides are updated, since taker and
+     maker share the slot on a self-trade */
+  if(maker_pos.qty == 0)
+    positions_.release(maker_user_id);
+
+  if(taker_user_id != maker_user_id && taker_pos.qty == 0)
+    positions_.release(taker_user_id);
 }
 
 template <class Tracker>
@@ -117,7 +126,6 @@ void PositionsPlugin<Tracker>::update_position(
   else {
     /* closing and potentially reversing the position */
     if(new_qty == 0 || ((new_qty > 0) != (pos.qty > 0))) {
-      /* TODO: erase position */
       this->emit_callback(TypedCallback::position_close(user_id));
       on_position_close(user_id);
 
@@ -141,12 +149,12 @@ template <class Tracker>
 bool PositionsPlugin<Tracker>::get_position(
   uint64_t user_id, Position& position)
 {
-  auto it = positions_.find(user_id);
-  
-  if(it == positions_.end())
+  uint32_t slot = positions_.find(user_id);
+
+  if(slot == PositionStore::npos)
     return false;
 
-  position = it->second;
+  position = positions_.at(slot);
   return true;
 }
 
@@ -5,6 +5,7 @@
 
 #pragma once
 
+#include <book/order.h>
 #include <book/plugin.h>
 #include <book/exceptions.h>
 #include <book/types.h>
@@ -12,10 +13,17 @@
 namespace book {
 namespace plugins {
 
-template <class OrderPtr>
-struct PostOnlyTracker {
+BOOK_ORDER_REQUIREMENT(post_only)
+
+template <class Base>
+struct PostOnlyTracker : public Base {
+  typedef typename Base::OrderPtr OrderPtr;
+
+  static_assert(order_has_post_only<OrderPtr>::value,
+    "post-only plugin requires orders to provide post_only()");
+
   PostOnlyTracker(const OrderPtr& order) :
-    post_only_(order->post_only()) {}
+    Base(order), post_only_(order->post_only()) {}
   
   bool post_only() const { return post_only_; };
 
@@ -23,10 +31,6 @@ struct PostOnlyTracker {
     bool post_only_;
 };
 
-struct PostOnlyOrder {
-  virtual bool post_only() const = 0;
-};
-
 template <class Tracker>
 class PostOnlyPlugin :
 public Plugin<Tracker>
@@ -34,6 +38,10 @@ public Plugin<Tracker>
 protected:
   typedef typename Tracker::OrderPtr OrderPtr;
 
+  bool should_fill_level(const Tracker& taker) {
+    return !taker.post_only();
+  }
+
   void should_trade(
     Tracker& taker,
     Tracker& maker,
@@ -5,11 +5,11 @@
 
 #pragma once
 
-#include <list>
 #include <cassert>
-#include <map>
+#include <cmath>
 
 #include <book/tracker.h>
+#include <utils/intrusive_user_list.h>
 #include "positions.h"
 
 #include <book/plugins/trackers/user_id_tracker.h>
@@ -17,28 +17,41 @@
 namespace book {
 namespace plugins {
 
-template <class OrderPtr>
-struct ReduceOnlyTracker : public virtual UserIDTracker<OrderPtr>,
-public virtual BaseTracker<OrderPtr> {
+const uint32_t REDUCE_ONLY_NULL_NODE = utils::NULL_USER_NODE;
+
+BOOK_ORDER_REQUIREMENT(reduce_only)
+
+template <class Base>
+struct ReduceOnlyTracker : public WithUserID<Base> {
+  typedef typename Base::OrderPtr OrderPtr;
+
+  static_assert(order_has_reduce_only<OrderPtr>::value,
+    "reduce-only plugin requires orders to provide reduce_only()");
+
   ReduceOnlyTracker(const OrderPtr& order) :
-    BaseTracker<OrderPtr>(order),
-    reduce_only_(order->reduce_only()),
-    is_bid_(order->is_bid()) {
-      UserIDTracker<OrderPtr>::set_user_id(order->user_id());
-    }
+    WithUserID<Base>(order),
+    reduce_only_node_(REDUCE_ONLY_NULL_NODE),
+    reduce_only_(order->reduce_only()) {}
   
   bool reduce_only() const { return reduce_only_; };
-  bool is_bid() const { return is_bid_; }
+
+  /* position in the plugin's per-user list while on the book */
+  uint32_t reduce_only_node() const { return reduce_only_node_; }
+  void reduce_only_node(uint32_t node) { reduce_only_node_ = node; }
 
   private:
+    uint32_t reduce_only_node_;
     const bool reduce_only_;
-    const bool is_bid_;
 };
 
-struct ReduceOnlyOrder {
-  virtual bool reduce_only() const = 0;
-};
 
+/*
+  Resting reduce-only orders are kept in intrusive per-user lists. Each
+  node holds the order's position in the book, so that closing a position
+  cancels the user's k orders in O(k) without looking them up, and each
+  tracker holds its node so that it is unlinked in O(1) when it leaves
+  the book.
+*/
 
 template <class Tracker>
 class ReduceOnlyPlugin : public virtual PositionsInterface,
@@ -46,6 +59,10 @@ public Plugin<Tracker> {
 protected:
   typedef typename Tracker::OrderPtr OrderPtr;
   typedef Callback<OrderPtr> TypedCallback;
+  typedef typename Plugin<Tracker>::TrackerMap TrackerMap;
+
+  /* resting reduce-only makers are checked one by one */
+  bool should_fill_level(const Tracker& taker) { return false; }
 
   void should_trade(
     Tracker& taker,
@@ -68,8 +85,11 @@ protected:
     assert(found);
     assert((position.qty > 0) != tracker.is_bid());
 
-    if(tracker.open_qty() > fabs(position.qty))
-      this->do_replace(tracker.ptr(), fabs(position.qty) - tracker.open_qty());
+    /* the maker is resting, its node holds its position in the book */
+    if(tracker.open_qty() > fabs(position.qty) &&
+      this->do_replace(orders_.value(tracker.reduce_only_node()),
+        fabs(position.qty) - tracker.open_qty()))
+      this->emit_callback(TypedCallback::book_update());
   
     return false;
   }
@@ -87,25 +107,38 @@ protected:
       reason = reduce_only_increase;
     else if(taker.open_qty() > fabs(position.qty))
       reason = reduce_only_reverse;
-    else
-      reduce_only_orders_.emplace(taker.user_id(), taker.ptr());
   }
 
-  void on_position_close(uint64_t user_id) {
-    /* cancel all reduce only orders */
-    for(auto it = reduce_only_orders_.find(user_id);
-      it != reduce_only_orders_.end(); ++it)
-    {
-      if(it->first != user_id) return;
-      this->do_cancel(it->second, reduce_only_close);
+  void after_insert_tracker(const typename TrackerMap::iterator& it) {
+    Tracker& tracker = it->second;
+    if(tracker.reduce_only())
+      tracker.reduce_only_node(orders_.link(tracker.user_id(), it));
+  }
+
+  void before_erase_tracker(const typename TrackerMap::iterator& it) {
+    Tracker& tracker = it->second;
+    if(tracker.reduce_only_node() != REDUCE_ONLY_NULL_NODE) {
+      orders_.unlink(tracker.reduce_only_node());
+      tracker.reduce_only_node(REDUCE_ONLY_NULL_NODE);
     }
+  }
 
-    reduce_only_orders_.erase(user_id);
+  void on_halt(CancelReasons reason) {
+    orders_.clear();
   }
 
-private:
-  std::multimap<uint64_t, OrderPtr> reduce_only_orders_;
+  void on_position_close(uint64_t user_id) {
+    /* cancel all reduce only orders. cancelling unlinks the node,
+       so the next one is read beforehand */
+    for(uint32_t node = orders_.head(user_id); node != REDUCE_ONLY_NULL_NODE;) {
+      uint32_t next = orders_.next(node);
+      this->do_cancel(orders_.value(node), reduce_only_close);
+      node = next;
+    }
+  }
 
+private:
+  utils::IntrusiveUserList<typename TrackerMap::iterator> orders_;
 };
 
 }
@@ -7,18 +7,20 @@
   The plugin enables asynchronous matching on an external exchange, then handles
   callbacks as if the match occured internally.
 
-  - HOOK after_trade: if a trade involves a MM order,
-    create a routing request for routing the order
+  - HOOK after_trade: if a trade involves a MM order, add it to the routing
+    plan of the taker, on the leg of the MM's exchange
 
   - HOOK should_trade: temporary cancels the taker order pending routing response
+    when it reaches a user order after MM orders
 
   - HOOK after_add_tracker: silently cancel the remaining qty of the user order,
-    submit a routing request, and erase the callbacks related to the user order
-  
-  - on_routing_success: issue a fill callback (and possibly a cancel callback too
-    if there is qty remaining), and add_tracker() the tracker with the remaining qty if any.
+    dispatch one routing request per leg of the plan, and erase the callbacks
+    related to the user order
 
-  - on_routing_failure: issue a cancel callback
+  - on_routing_success / on_routing_failure: record the leg's outcome. once
+    every leg of the plan has returned, replay the fills of the successful legs
+    in the order they matched. if all legs succeeded, add_tracker() the tracker
+    with the remaining qty if any, otherwise issue a cancel callback
 
 
   ASSUMPTIONS
@@ -42,16 +44,16 @@
 
   - callbacks publisher
     if(not (external only or broadcast_to_all)) return
+
+  CallbackDispatcher (dispatcher.h) routes callbacks to consumers
+  subscribed this way.
 */
 
 #pragma once
 
 #include <iostream>
 #include <vector>
-#include <list>
 #include <unordered_map>
-#include <set>
-#include <memory>
 
 #include <book/types.h>
 #include <book/tracker.h>
@@ -62,7 +64,10 @@
 #include <book/callback.h>
 
 #include <utils/uint128.h>
-#include <utils/ts.h>
+#include <utils/sequence_id.h>
+#include <utils/object_pool.h>
+#include <utils/fixed_vector.h>
+#include <utils/flat_set.h>
 
 #include <book/plugins/trackers/user_id_tracker.h>
 
@@ -71,29 +76,55 @@ using namespace utils;
 namespace book {
 namespace plugins {
 
-template <class OrderPtr>
-struct RoutableTracker :
-public virtual UserIDTracker<OrderPtr>, public virtual BaseTracker<OrderPtr> 
-{
-public:
-  RoutableTracker(const OrderPtr& order) :
-    BaseTracker<OrderPtr>(order) {
-    UserIDTracker<OrderPtr>::set_user_id(order->user_id());
-  }
+template <class Base>
+struct RoutableTracker : public WithUserID<Base> {
+  typedef typename Base::OrderPtr OrderPtr;
 
-  void fill(double fill_qty, double fill_cost) {
-    BaseTracker<OrderPtr>::fill(fill_qty, fill_cost);
-  }
+  static_assert(order_has_order_id<OrderPtr>::value,
+    "routing plugin requires orders to provide order_id()");
+
+  RoutableTracker(const OrderPtr& order) : WithUserID<Base>(order) {}
 };
 
-template <class Tracker>
+/*
+  A taker sweeping MM orders of several exchanges produces one routing plan,
+  with one leg (routing request) per exchange. All legs are dispatched at
+  once, so the taker waits for a single round trip whatever the number of
+  venues. Fills are reconciled in price-time order, i.e. the order in which
+  they matched, once the last leg has returned.
+
+  Plans and legs are drawn from pools of MAX_PENDING_REQUESTS slots allocated
+  with the book. A plan holds the taker tracker and the replayed callbacks
+  inline, and carries at most MAX_REQUEST_FILLS MM fills over at most
+  MAX_ROUTING_LEGS exchanges; past that, the taker is temporarily cancelled
+  and added again once the plan is complete. When the pools are exhausted, MM
+  orders that would start a new plan are cancelled with routing_failure.
+
+  Request ids are sequence ids (see utils/sequence_id.h) carrying the symbol
+  and the routing shard, so they are unique across the engine and increasing
+  per book. A request lives in slot `sequence % MAX_PENDING_REQUESTS`; the
+  sequence skips numbers whose slot is still taken by a slow request.
+*/
+
+template <class Tracker,
+  size_t MAX_PENDING_REQUESTS = ROUTING_MAX_PENDING_REQUESTS,
+  size_t MAX_REQUEST_FILLS = ROUTING_MAX_REQUEST_FILLS,
+  size_t MAX_ROUTING_LEGS = ROUTING_MAX_LEGS>
 class RoutablePlugin :
 public Plugin<Tracker> {
 public:
   typedef typename Tracker::OrderPtr OrderPtr;
-  typedef std::shared_ptr<Tracker> TrackerPtr;
   typedef Callback<OrderPtr> TypedCallback;
+  typedef FixedVector<TypedCallback, MAX_REQUEST_FILLS> RequestCallbacks;
+  typedef FixedVector<uint128, MAX_REQUEST_FILLS> MakerOrderIds;
+
+  enum RequestStatus : uint8_t {
+    request_pending,
+    request_succeeded,
+    request_failed
+  };
 
+  /* one leg of a routing plan */
   struct RoutingRequest {
     uint64_t request_id;
     uint32_t exchange_id;
@@ -102,13 +133,18 @@ public:
     double price;
     bool is_bid;
     CancelReasons cancel_reason;
-    TrackerPtr maker;
-    TrackerPtr taker;
-    std::list<TypedCallback> callbacks;
+    RequestStatus status;
+    MakerOrderIds maker_order_ids;
+    uint32_t plan;
   };
 
-  RoutablePlugin() {
-    next_routing_request_.request_id = 0;
+  RoutablePlugin() :
+    requests_(MAX_PENDING_REQUESTS),
+    plans_(MAX_PENDING_REQUESTS),
+    pending_maker_order_ids_(MAX_PENDING_REQUESTS * MAX_REQUEST_FILLS),
+    routing_shard_(0),
+    request_sequence_(0)
+  {
     reset_request();
   }
 
@@ -117,10 +153,45 @@ public:
     X2MMU_.emplace(external_exchange_id, user_id);
   }
 
+  size_t pending_requests_size() const {
+    return requests_.size();
+  }
+
+  /* distinguishes books of the same symbol, e.g. one per matching engine */
+  void set_routing_shard(uint8_t shard) {
+    routing_shard_ = shard;
+  }
+
 private:
-  RoutingRequest next_routing_request_;
-  std::unordered_map<uint64_t, RoutingRequest> pending_requests_;
-  std::set<uint128> pending_maker_order_ids_;
+  typedef FixedVector<uint32_t, MAX_ROUTING_LEGS> LegSlots;
+
+  struct RoutingPlan {
+    RoutingPlan(const Tracker& taker) :
+      taker(taker), outstanding(0), failed_qty(0) {}
+
+    Tracker taker;
+    LegSlots legs;
+    RequestCallbacks callbacks;
+    size_t outstanding;
+    double failed_qty;
+  };
+
+  /* the plan being built while the taker is matching */
+  struct NextLeg {
+    uint32_t exchange_id;
+    double qty;
+    double price;
+    bool is_bid;
+    MakerOrderIds maker_order_ids;
+  };
+
+  FixedVector<NextLeg, MAX_ROUTING_LEGS> next_legs_;
+  size_t next_fills_;
+  ObjectPool<RoutingRequest> requests_;
+  ObjectPool<RoutingPlan> plans_;
+  FlatSet<uint128, uint128_hash> pending_maker_order_ids_;
+  uint8_t routing_shard_;
+  uint64_t request_sequence_;
   bool market_price_changed_;
   bool should_route_;
 
@@ -132,9 +203,8 @@ protected:
   virtual void on_routing_request(const RoutingRequest& request) = 0;
 
   void reset_request() {
-    next_routing_request_.callbacks.clear();
-    next_routing_request_.qty = 0;
-    next_routing_request_.cancel_reason = dont_cancel;
+    next_legs_.clear();
+    next_fills_ = 0;
     market_price_changed_ = false;
     should_route_ = false;
   }
@@ -142,9 +212,37 @@ protected:
   void after_add_tracker(Tracker& taker) {
     if(!should_route_) return;
 
-    /* cancel taker order.
+    /* the taker is copied into the plan before being cancelled.
       XXX: `taker` will become dangling, do not use in the rest of
-      this function. use next_routing_request_.taker instead  */
+      this function. use plan.taker instead  */
+    uint32_t plan_slot = plans_.acquire(taker);
+    assert(plan_slot != ObjectPool<RoutingPlan>::npos);
+
+    RoutingPlan& plan = plans_[plan_slot];
+
+    for(auto leg = next_legs_.begin(); leg != next_legs_.end(); ++leg) {
+      uint64_t request_id = next_request_id();
+      uint32_t slot = request_slot(request_id);
+      requests_.acquire_at(slot);
+
+      RoutingRequest& request = requests_[slot];
+      request.request_id = request_id;
+      request.exchange_id = leg->exchange_id;
+      request.symbol_id = this->symbol_id();
+      request.qty = leg->qty;
+      request.price = leg->price;
+      request.is_bid = leg->is_bid;
+      request.cancel_reason = dont_cancel;
+      request.status = request_pending;
+      request.maker_order_ids = leg->maker_order_ids;
+      request.plan = plan_slot;
+
+      plan.legs.push_back(slot);
+    }
+
+    plan.outstanding = plan.legs.size();
+
+    /* cancel taker order */
     this->do_cancel(taker.ptr(), CancelReasons::temporary_cancel);
 
     /* remove fill callbacks related to MM matching */
@@ -167,7 +265,7 @@ protected:
 
       /* ignore if order id is irrelevant */
       if(cb.order->order_id() !=
-          next_routing_request_.taker->ptr()->order_id()) continue;
+          plan.taker.ptr()->order_id()) continue;
 
       /* ignore irrelevant trade with non-MM maker*/
       if(cb.type == Callback<OrderPtr>::cb_trade &&
@@ -175,7 +273,7 @@ protected:
 
       if(cb.type == Callback<OrderPtr>::cb_trade) {
         cb.scope = Callback<OrderPtr>::CbScope::internal_only;
-        next_routing_request_.callbacks.push_back(cb);
+        plan.callbacks.push_back(cb);
       }
       
       /* save the fact that it was cancelled afterwards, if it was */
@@ -184,14 +282,19 @@ protected:
       }
     }
 
-    /* submit the request */
-
-    next_routing_request_.request_id = ts();
-    auto emplaced = pending_requests_.emplace(
-      next_routing_request_.request_id, next_routing_request_);
-    
     reset_request();
-    on_routing_request(emplaced.first->second);
+
+    /* dispatch every leg. responses may come back synchronously, and
+       the plan is released as soon as the last leg has returned, so
+       it must not be touched after the last dispatch */
+    LegSlots legs = plan.legs;
+    for(auto it = legs.begin(); it != legs.end(); ++it)
+      on_routing_request(requests_[*it]);
+  }
+
+  /* any maker may be a MM order to route */
+  bool should_fill_level(const Tracker& taker) {
+    return MMU2X_.empty();
   }
 
   void should_trade(
@@ -213,10 +316,14 @@ protected:
       maker_reason = mm_routed;
     }
 
-    /* we've hit a different exchange -- cancel taker.
-     * will be added again once it has been routed to first exchange */
-    if(should_route_ && 
-      next_routing_request_.exchange_id != exchange_id_it->second) {
+    /* no room left for a new plan -- cancel maker */
+    else if(!should_route_ && (plans_.full() || requests_.full())) {
+      maker_reason = routing_failure;
+    }
+
+    /* the plan can't take this fill -- cancel taker.
+     * will be added again once the plan has been routed */
+    if(should_route_ && !can_extend_plan(exchange_id_it->second)) {
       taker_reason = temporary_cancel;
     }
   }
@@ -238,45 +345,83 @@ protected:
     market_price_changed_ = false;
     pending_maker_order_ids_.insert(maker.ptr()->order_id());
 
-    /* this calls copy ctor */
-    next_routing_request_.taker = std::make_shared<Tracker>(taker);
-    next_routing_request_.maker = std::make_shared<Tracker>(maker);
+    NextLeg* leg = find_next_leg(exchange_id_it->second);
+
+    if(!leg) {
+      next_legs_.push_back(NextLeg());
+      leg = &next_legs_.back();
+      leg->exchange_id = exchange_id_it->second;
+      leg->qty = 0;
+      leg->maker_order_ids.clear();
+    }
 
-    next_routing_request_.exchange_id = exchange_id_it->second;
-    next_routing_request_.symbol_id = this->symbol_id();
-    next_routing_request_.qty += qty;
+    leg->maker_order_ids.push_back(maker.ptr()->order_id());
+    leg->qty += qty;
 
     /* after each trade, the price gets worse. so we're expected 
       to send the worst price on the request. */
-    next_routing_request_.price = price;
-    next_routing_request_.is_bid = !maker_is_bid;
+    leg->price = price;
+    leg->is_bid = !maker_is_bid;
+
+    ++next_fills_;
     should_route_ = true;
   }
 
   void on_routing_success(uint64_t request_id) {
-    RoutingRequest& request = pending_requests_.at(request_id);
+    uint32_t slot = request_slot(request_id);
+
+    /* unknown or already handled */
+    if(!is_pending(slot, request_id)) return;
 
-    const TrackerPtr& maker = request.maker, taker = request.taker;
+    RoutingRequest& request = requests_[slot];
+    request.status = request_succeeded;
+
+    RoutingPlan& plan = plans_[request.plan];
+    if(--plan.outstanding == 0) reconcile(request.plan);
+  }
+
+  void on_routing_failure(uint64_t request_id) {
+    uint32_t slot = request_slot(request_id);
+
+    /* unknown or already handled */
+    if(!is_pending(slot, request_id)) return;
+
+    RoutingRequest& request = requests_[slot];
+    request.status = request_failed;
+
+    RoutingPlan& plan = plans_[request.plan];
+    plan.failed_qty += request.qty;
+    if(--plan.outstanding == 0) reconcile(request.plan);
+  }
+
+private:
+  /* called once every leg of the plan has returned */
+  void reconcile(uint32_t plan_slot) {
+    RoutingPlan& plan = plans_[plan_slot];
+    Tracker& taker = plan.taker;
+
+    /* replay the fills of successful legs, in the order they matched */
+    for(auto it = plan.callbacks.begin(); it != plan.callbacks.end(); ++it) {
+      if(it->type == Callback<OrderPtr>::cb_trade &&
+        leg_failed(plan, MMU2X_.at(it->maker_order->user_id()))) continue;
 
-    /* replay callbacks */
-    for(auto it = request.callbacks.begin(); it != request.callbacks.end(); ++it) {
       it->scope = Callback<OrderPtr>::CbScope::external_only;
       this->emit_callback(*it);
     }
 
-    /* if there's qty remaining */
-    if(request.cancel_reason == dont_cancel) {
-      if(!taker->filled()) {
+    if(plan.failed_qty == 0) {
+      /* if there's qty remaining */
+      if(!taker.filled()) {
         /* add the tracker again */
 
         /* before adding the tracker again, we must first process the 
-          callbacks related to this routing request, so as not to save 
-          them on any subsequent request resulting from add_tracker */
+          callbacks related to this routing plan, so as not to save 
+          them on any subsequent plan resulting from add_tracker */
         this->process_callbacks();
     
-        this->add_tracker(*taker);
+        this->add_tracker(taker);
         size_t accept_cb_index = this->callbacks().size();
-        this->emit_callback(TypedCallback::accept(taker->ptr()));
+        this->emit_callback(TypedCallback::accept(taker.ptr()));
 
         /* only need this to have the order in directory and order list*/
         this->callbacks()[accept_cb_index].scope =
@@ -285,40 +430,91 @@ protected:
       }
     }
 
-    pending_maker_order_ids_.erase(maker->ptr()->order_id());
+    else {
+      size_t cancel_cb_index = this->callbacks().size();
+      this->emit_cancel_callback(taker, routing_failure);
+
+      /* do not change depth again */
+      this->callbacks()[cancel_cb_index].scope =
+        Callback<OrderPtr>::CbScope::external_only;
+      
+      this->callbacks()[cancel_cb_index].qty -= plan.failed_qty;
+
+      /* used to free the hold */
+      this->callbacks()[cancel_cb_index].generic_1 =
+        plan.failed_qty + taker.qty_on_book();
+    }
+
+    release_plan(plan_slot);
     this->process_callbacks();
   }
 
-  void on_routing_failure(uint64_t request_id) {
-    RoutingRequest& request = pending_requests_.at(request_id);
+  bool leg_failed(const RoutingPlan& plan, uint32_t exchange_id) const {
+    for(auto it = plan.legs.begin(); it != plan.legs.end(); ++it) {
+      const RoutingRequest& request = requests_[*it];
+      if(request.exchange_id == exchange_id)
+        return request.status == request_failed;
+    }
 
-    const TrackerPtr& maker = request.maker, taker = request.taker;
+    return false;
+  }
 
-    /* replay callbacks */
-    for(auto it = request.callbacks.begin(); it != request.callbacks.end(); ++it) {
-      /* dont replay the fill with this MM */
-      if(it->type == Callback<OrderPtr>::cb_trade &&
-        it->maker_order->user_id() == X2MMU_.at(request.exchange_id)) continue;
+  NextLeg* find_next_leg(uint32_t exchange_id) {
+    for(auto it = next_legs_.begin(); it != next_legs_.end(); ++it)
+      if(it->exchange_id == exchange_id) return it;
 
-      it->scope = Callback<OrderPtr>::CbScope::external_only;
-      this->emit_callback(*it);
-    }
+    return nullptr;
+  }
 
-    size_t cancel_cb_index = this->callbacks().size();
-    this->emit_cancel_callback(*taker, routing_failure);
+  bool can_extend_plan(uint32_t exchange_id) {
+    if(next_fills_ == MAX_REQUEST_FILLS)
+      return false;
 
-    /* do not change depth again */
-    this->callbacks()[cancel_cb_index].scope =
-      Callback<OrderPtr>::CbScope::external_only;
-    
-    this->callbacks()[cancel_cb_index].qty -= request.qty;
+    if(find_next_leg(exchange_id))
+      return true;
+
+    /* a new leg needs a request slot of its own */
+    return !next_legs_.full() &&
+      requests_.size() + next_legs_.size() < requests_.capacity();
+  }
 
-    /* used to free the hold */
-    this->callbacks()[cancel_cb_index].generic_1 = request.qty + taker->qty_on_book();
+  uint32_t request_slot(uint64_t request_id) const {
+    return (uint32_t)(seq_id_sequence(request_id) % MAX_PENDING_REQUESTS);
+  }
 
-    pending_maker_order_ids_.erase(maker->ptr()->order_id());
+  bool is_pending(uint32_t slot, uint64_t request_id) const {
+    return requests_.live(slot) &&
+      requests_[slot].request_id == request_id &&
+      requests_[slot].status == request_pending;
+  }
 
-    this->process_callbacks();
+  /* the caller makes sure there is a free slot (see should_trade) */
+  uint64_t next_request_id() {
+    assert(!requests_.full());
+    uint64_t request_id;
+
+    do {
+      request_id = make_seq_id(
+        this->symbol_id(), routing_shard_, ++request_sequence_);
+    } while(requests_.live(request_slot(request_id)));
+
+    return request_id;
+  }
+
+  void release_plan(uint32_t plan_slot) {
+    RoutingPlan& plan = plans_[plan_slot];
+
+    for(auto leg = plan.legs.begin(); leg != plan.legs.end(); ++leg) {
+      RoutingRequest& request = requests_[*leg];
+
+      for(auto it = request.maker_order_ids.begin();
+        it != request.maker_order_ids.end(); ++it)
+        pending_maker_order_ids_.erase(*it);
+
+      requests_.release(*leg);
+    }
+
+    plans_.release(plan_slot);
   }
 
 };
@@ -19,13 +19,17 @@ enum SelfTradePolicy : uint8_t {
   stp_cancel_both = 3
 };
 
-template <class OrderPtr>
-struct SelfTradePolicyTracker :
-public virtual UserIDTracker<OrderPtr>
-{
-  SelfTradePolicyTracker(const OrderPtr& order) : stp_(order->stp()) {
-    UserIDTracker<OrderPtr>::set_user_id(order->user_id());
-  }
+BOOK_ORDER_REQUIREMENT(stp)
+
+template <class Base>
+struct SelfTradePolicyTracker : public WithUserID<Base> {
+  typedef typename Base::OrderPtr OrderPtr;
+
+  static_assert(order_has_stp<OrderPtr>::value,
+    "self trade policy requires orders to provide stp()");
+
+  SelfTradePolicyTracker(const OrderPtr& order) :
+    WithUserID<Base>(order), stp_(order->stp()) {}
 
   SelfTradePolicy stp() const {
     return stp_;
@@ -35,12 +39,6 @@ private:
   SelfTradePolicy stp_;
 };
 
-
-struct SelfTradePolicyOrder {
-  virtual uint32_t user_id() const = 0;
-  virtual SelfTradePolicy stp() const = 0;
-};
-
 template <class Tracker>
 class SelfTradePolicyPlugin :
 public Plugin<Tracker>
@@ -49,6 +47,9 @@ protected:
   typedef typename Tracker::OrderPtr OrderPtr;
   typedef Tracker PluginTracker;
 
+  /* every maker's user must be checked */
+  bool should_fill_level(const Tracker& taker) { return false; }
+
   void should_trade(
     Tracker& taker,
     Tracker& maker,
@@ -0,0 +1,240 @@
+/*
+ *  Copyright (c) 2019-present, LBS Trading LLC. All rights reserved.
+ *  See the file LICENSE.md for licensing information.
+ */
+
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <algorithm>
+
+#include <book/plugin.h>
+#include <book/tracker.h>
+#include <book/book_price.h>
+
+namespace book {
+namespace plugins {
+
+template <class OrderPtr>
+struct OrderSnapshot {
+  OrderPtr order;
+  double open_qty;
+  double filled_qty;
+  double avg_price;
+};
+
+template <class OrderPtr>
+struct LevelSnapshot {
+  double price;
+  double qty;
+  std::vector<OrderSnapshot<OrderPtr>> orders; /* in time priority */
+};
+
+/* an immutable view of a book, as of the publish_snapshot() that made it */
+template <class OrderPtr>
+struct BookSnapshot {
+  typedef LevelSnapshot<OrderPtr> Level;
+  typedef std::shared_ptr<const Level> LevelPtr;
+  typedef std::vector<LevelPtr> Levels;
+
+  uint64_t version; /* 0 until the first publish */
+  uint32_t symbol_id;
+  double market_price;
+  Levels bids; /* best first */
+  Levels asks;
+
+  BookSnapshot() : version(0), symbol_id(0), market_price(0) {}
+
+  const Levels& side(bool is_bid) const { return is_bid ? bids : asks; }
+
+  /* nullptr if there is no order at `price` */
+  const Level* level(bool is_bid, double price) const {
+    const Levels& levels = side(is_bid);
+
+    auto it = std::lower_bound(levels.begin(), levels.end(), price,
+      [is_bid](const LevelPtr& level, double rhs) {
+        return BookPrice(is_bid, level->price) < rhs;
+      });
+
+    return it != levels.end() && (*it)->price == price ? it->get() : nullptr;
+  }
+
+  /* nullptr if the order isn't resting */
+  const OrderSnapshot<OrderPtr>* find(const OrderPtr& order) const {
+    const Level* at = level(order->is_bid(), order->price());
+    if(!at) return nullptr;
+
+    for(auto& entry : at->orders)
+      if(entry.order == order) return &entry;
+
+    return nullptr;
+  }
+};
+
+
+/*
+  Publishes immutable snapshots of the book that any number of threads
+  can query while matching goes on.
+
+  The matching thread calls publish_snapshot(), e.g. from on_callbacks()
+  on a book update. Other threads call snapshot() and hold on to the
+  result as long as they like: a snapshot is never modified, and is freed
+  when its last reader lets go of it. Publishing swaps a shared_ptr, so
+  neither side waits for the other beyond that.
+
+  Snapshots are copy-on-write at the level. The hooks note the price
+  levels that changed since the last publish, and only those are copied
+  from the book; the others are shared with the previous snapshot.
+  Publishing is O(levels + orders at the changed levels).
+*/
+
+template <class Tracker>
+class SnapshotPlugin : public Plugin<Tracker> {
+public:
+  typedef typename Tracker::OrderPtr OrderPtr;
+  typedef typename Plugin<Tracker>::TrackerMap TrackerMap;
+  typedef BookSnapshot<OrderPtr> Snapshot;
+  typedef std::shared_ptr<const Snapshot> SnapshotPtr;
+
+  SnapshotPlugin() :
+    published_(std::make_shared<Snapshot>()),
+    current_(published_),
+    changed_(false),
+    cleared_(false) {}
+
+  /* from the matching thread. returns the version published, the
+     previous one if nothing changed */
+  uint64_t publish_snapshot() {
+    if(!changed_) return published_->version;
+
+    std::shared_ptr<Snapshot> next = std::make_shared<Snapshot>();
+    next->version = published_->version + 1;
+    next->symbol_id = this->symbol_id();
+    next->market_price = this->market_price();
+
+    const typename Snapshot::Levels none;
+
+    rebuild(true, this->bids(), cleared_ ? none : published_->bids,
+      dirty_[0], next->bids);
+    rebuild(false, this->asks(), cleared_ ? none : published_->asks,
+      dirty_[1], next->asks);
+
+    dirty_[0].clear();
+    dirty_[1].clear();
+    changed_ = cleared_ = false;
+
+    published_ = next;
+    std::atomic_store(&current_, published_);
+
+    return published_->version;
+  }
+
+  /* from any thread */
+  SnapshotPtr snapshot() const {
+    return std::atomic_load(&current_);
+  }
+
+protected:
+  void after_insert_tracker(const typename TrackerMap::iterator& it) {
+    touch(it->first);
+  }
+
+  void before_erase_tracker(const typename TrackerMap::iterator& it) {
+    touch(it->first);
+  }
+
+  void after_replace_tracker(const typename TrackerMap::iterator& it) {
+    touch(it->first);
+  }
+
+  void after_trade(
+    Tracker& taker,
+    Tracker& maker,
+    bool maker_is_bid,
+    double qty,
+    double price)
+  {
+    touch(BookPrice(maker_is_bid, maker.price()));
+  }
+
+  void on_market_price_change(double prev_price, double new_price) {
+    changed_ = true;
+  }
+
+  void on_halt(CancelReasons reason) {
+    dirty_[0].clear();
+    dirty_[1].clear();
+    changed_ = cleared_ = true;
+  }
+
+private:
+  SnapshotPtr published_; /* matching thread only */
+  SnapshotPtr current_;   /* shared, through atomic_load/atomic_store */
+
+  std::vector<double> dirty_[2]; /* prices changed, bids then asks */
+  bool changed_;
+  bool cleared_; /* the book was emptied by a halt */
+
+  void touch(const BookPrice& price) {
+    dirty_[price.is_bid() ? 0 : 1].push_back(price.price());
+    changed_ = true;
+  }
+
+  /* merges the levels of `prev` with the `dirty` ones, copied from the
+     book, in book order */
+  static void rebuild(
+    bool is_bid,
+    const TrackerMap& trackers,
+    const typename Snapshot::Levels& prev,
+    std::vector<double>& dirty,
+    typename Snapshot::Levels& out)
+  {
+    std::sort(dirty.begin(), dirty.end(), [is_bid](double lhs, double rhs) {
+      return BookPrice(is_bid, lhs) < rhs;
+    });
+    dirty.erase(std::unique(dirty.begin(), dirty.end()), dirty.end());
+
+    out.reserve(prev.size() + dirty.size());
+
+    size_t i = 0;
+    for(double price : dirty) {
+      for(; i < prev.size() && BookPrice(is_bid, prev[i]->price) < price; ++i)
+        out.push_back(prev[i]);
+
+      if(i < prev.size() && prev[i]->price == price) ++i;
+
+      auto level = copy_level(is_bid, trackers, price);
+      if(level) out.push_back(std::move(level));
+    }
+
+    out.insert(out.end(), prev.begin() + i, prev.end());
+  }
+
+  static std::shared_ptr<const LevelSnapshot<OrderPtr>> copy_level(
+    bool is_bid, const TrackerMap& trackers, double price)
+  {
+    auto range = trackers.equal_range(BookPrice(is_bid, price));
+    if(range.first == range.second) return nullptr;
+
+    std::shared_ptr<LevelSnapshot<OrderPtr>> level =
+      std::make_shared<LevelSnapshot<OrderPtr>>();
+    level->price = price;
+    level->qty = 0;
+
+    for(auto it = range.first; it != range.second; ++it) {
+      const Tracker& tracker = it->second;
+      level->qty += tracker.qty_on_book();
+      level->orders.push_back(OrderSnapshot<OrderPtr>{
+        tracker.ptr(),
+        tracker.qty_on_book(),
+        tracker.filled_qty(),
+        tracker.avg_price() });
+    }
+
+    return level;
+  }
+};
+
+}
+}
@@ -1,14 +1,19 @@
 #pragma once
 
+#include <book/order.h>
 #include <book/plugin.h>
 #include <book/book_price.h>
+#include <book/plugins/trailing_stops.h>
 
 namespace book {
 namespace plugins {
 
-struct StopOrder {
-  virtual double stop_price() const = 0;
-};
+/* orders provide stop_price(), trailing_type() and trailing_offset().
+ * trailing_type() is trail_none for plain stop orders. trailing stops
+ * have a zero stop_price() */
+BOOK_ORDER_REQUIREMENT(stop_price)
+BOOK_ORDER_REQUIREMENT(trailing_type)
+BOOK_ORDER_REQUIREMENT(trailing_offset)
 
 template <class Tracker>
 class StopOrdersPlugin : public Plugin<Tracker> {
@@ -18,17 +23,34 @@ public:
 	using TrackerVec = typename Plugin<Tracker>::TrackerVec;
 	using TypedCallback = typename Plugin<Tracker>::TypedCallback;
 
+	static_assert(order_has_stop_price<OrderPtr>::value &&
+		order_has_trailing_type<OrderPtr>::value &&
+		order_has_trailing_offset<OrderPtr>::value,
+		"stop orders plugin requires orders to provide stop_price(), "
+		"trailing_type() and trailing_offset()");
+
+	StopOrdersPlugin() : trailing_bids_(true), trailing_asks_(false) {}
+
 protected:
 	bool should_add_tracker(const Tracker& taker) override {
-		double stop_price = taker.ptr()->stop_price();
-		return stop_price == 0 || add_stop_order(taker, stop_price);
+		const OrderPtr& order = taker.ptr();
+
+		if(order->trailing_type() != trail_none) {
+			add_trailing_stop_order(taker, order->trailing_type(), order->trailing_offset());
+			return false;
+		}
+
+		double stop_price = order->stop_price();
+		return stop_price == 0 || !add_stop_order(taker, stop_price);
 	}
 
 	void on_market_price_change(double prev_price, double new_price) override {
 		if(prev_price == new_price) return;
 		auto& trackers = new_price > prev_price ? stop_bids_ : stop_asks_;
-		BookPrice until(new_price > prev_price, new_price);
-		check_stop_orders(trackers, until);
+		check_stop_orders(trackers, new_price);
+
+		trailing_bids_.on_market_price_change(new_price, pending_orders_);
+		trailing_asks_.on_market_price_change(new_price, pending_orders_);
 	}
 
   void after_add_tracker(const Tracker& taker) override {
@@ -36,18 +58,36 @@ protected:
       submit_pending_orders();
   }
 
+	void on_halt(CancelReasons reason) override {
+		trailing_bids_.drain(pending_orders_);
+		trailing_asks_.drain(pending_orders_);
+
+		for(auto& entry : stop_bids_) cancel_stop(entry.second, reason);
+		for(auto& entry : stop_asks_) cancel_stop(entry.second, reason);
+		for(auto& tracker : pending_orders_) cancel_stop(tracker, reason);
+
+		stop_bids_.clear();
+		stop_asks_.clear();
+		pending_orders_.clear();
+	}
+
 
 private:
+	/* keyed by the opposite side, so that the stop
+	 * closest to being triggered comes first */
 	TrackerMap stop_bids_;
 	TrackerMap stop_asks_;
+	TrailingStopIndex<Tracker> trailing_bids_;
+	TrailingStopIndex<Tracker> trailing_asks_;
 	TrackerVec pending_orders_;
 
+	/* returns false if the stop is triggered right away */
 	bool add_stop_order(const Tracker& tracker, double stop_price) {
 	  bool is_bid = tracker.is_bid();
-	  BookPrice key(is_bid, stop_price);
+	  BookPrice key(!is_bid, stop_price);
 
 	  /* triggered */
-	  if(key >= this->market_price()) return false;
+	  if(!(key > this->market_price())) return false;
 
     if(is_bid)
       stop_bids_.emplace(key, tracker);
@@ -57,13 +97,26 @@ private:
 	  return true;
 	}
 
-	void check_stop_orders(TrackerMap& stops, BookPrice& until) {
-		auto pos = stops.begin(); 
+	/* stops are not on the book, nothing to remove from depth */
+	void cancel_stop(const Tracker& tracker, CancelReasons reason) {
+		this->emit_callback(TypedCallback::cancel(
+			tracker.ptr(), 0, tracker.filled_qty(), tracker.avg_price(), reason));
+	}
+
+	void add_trailing_stop_order(const Tracker& tracker,
+		TrailingType type, double offset)
+	{
+		auto& trailing = tracker.is_bid() ? trailing_bids_ : trailing_asks_;
+		trailing.add(tracker, this->market_price(), type, offset);
+	}
+
+	void check_stop_orders(TrackerMap& stops, double price) {
+		auto pos = stops.begin();
 		while(pos != stops.end()) {
 			auto here = pos++;
 			Tracker & tracker = here->second;
 
-			if(here->first < until)
+			if(here->first > price)
 				break;
 
 			pending_orders_.push_back(std::move(tracker));
@@ -77,10 +130,10 @@ private:
 	  for(auto pos = pending.begin(); pos != pending.end(); ++pos) {
 	    Tracker& tracker = *pos;
 	    this->add_tracker(tracker);
-	    this->callbacks().push_back(TypedCallback::stop_trigger(tracker.ptr()));
+	    this->emit_callback(TypedCallback::stop_trigger(tracker.ptr()));
 	  }
   }
 };
 
 } // namespace plugins
-} // namespace book
\ No newline at end of file
+} // namespace book
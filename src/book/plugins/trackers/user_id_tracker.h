@@ -5,20 +5,33 @@
 
 #pragma once
 
-#include <iostream>
+#include <cstdint>
+#include <type_traits>
+
+#include <book/order.h>
 
 namespace book {
+
+BOOK_ORDER_REQUIREMENT(user_id)
+
 namespace plugins {
 
-template <class OrderPtr>
-struct UserIDTracker {
-  UserIDTracker() : user_id_(0) {}
+template <class Base>
+struct UserIDTracker : public Base {
+  typedef typename Base::OrderPtr OrderPtr;
+  typedef void has_user_id;
+
+  static_assert(order_has_user_id<OrderPtr>::value,
+    "plugin requires orders to provide user_id()");
+
+  UserIDTracker(const OrderPtr& order) :
+    Base(order), user_id_(order->user_id()) {}
 
-  virtual void set_user_id(uint64_t user_id) {
+  void set_user_id(uint64_t user_id) {
     user_id_ = user_id;
   }
 
-  virtual uint64_t user_id() const {
+  uint64_t user_id() const {
     return user_id_;
   };
 
@@ -26,5 +39,17 @@ struct UserIDTracker {
     uint64_t user_id_;
 };
 
+template <class Base, class = void>
+struct has_user_id : std::false_type {};
+
+template <class Base>
+struct has_user_id<Base, typename Base::has_user_id> : std::true_type {};
+
+/* base for mixins reading the user id: adds the field unless a mixin
+   below already did, so that it is stored once whatever the plugins */
+template <class Base>
+using WithUserID = typename std::conditional<
+  has_user_id<Base>::value, Base, UserIDTracker<Base>>::type;
+
+}
 }
-}
\ No newline at end of file
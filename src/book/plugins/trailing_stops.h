@@ -0,0 +1,267 @@
+/*
+ *  Copyright (c) 2019-present, LBS Trading LLC. All rights reserved.
+ *  See the file LICENSE.md for licensing information.
+ */
+
+/*
+  Index of trailing stop orders for one side of the book.
+
+  A trailing sell stop triggers once the price falls `offset` below the
+  highest price seen since the order was added (the watermark). A trailing
+  buy stop triggers once the price rises `offset` above the lowest price.
+
+  Every order has its own watermark, but watermarks are monotonic in entry
+  time: an older sell stop has seen every price a newer one has seen, so its
+  high can only be greater or equal. Orders are therefore kept in a stack of
+  groups sharing a watermark, newest group at the back. When the price
+  extends the watermark of the newest groups, they are merged into a single
+  group carrying the new price. The cost of a tick is the number of groups
+  merged, never the number of orders.
+
+  Within a group, orders are sorted by offset, so the closest trigger of a
+  group is its first entry. Groups are indexed by that closest trigger price,
+  making the trigger check a range query on the head of the index.
+
+  All comparisons are done on signed prices (s = +1 for buys, -1 for sells)
+  so that both sides share the same code:
+    - the watermark is extended by p iff s * p < s * watermark
+    - an order triggers at p iff s * trigger_price <= s * p
+*/
+
+#pragma once
+
+#include <list>
+#include <map>
+#include <vector>
+#include <iterator>
+#include <algorithm>
+
+#include <book/types.h>
+
+namespace book {
+namespace plugins {
+
+enum TrailingType : uint8_t {
+  trail_none,
+  trail_absolute, /* offset in quote currency */
+  trail_percent   /* offset as a fraction of the watermark, i.e. 0.05 for 5% */
+};
+
+template <class Tracker>
+class TrailingStopIndex {
+public:
+  typedef std::vector<Tracker> TrackerVec;
+
+  TrailingStopIndex(bool is_bid) : sign_(is_bid ? 1 : -1), size_(0) {}
+
+  void add(const Tracker& tracker, double watermark,
+    TrailingType type, double offset);
+
+  /* updates the watermarks, then moves triggered trackers to `out` */
+  void on_market_price_change(double price, TrackerVec& out);
+
+  bool empty() const { return heads_.empty(); }
+
+  size_t size() const { return size_; }
+
+  /* moves every tracker to `out`, in no particular order */
+  void drain(TrackerVec& out);
+
+private:
+  struct Group;
+
+  typedef std::multimap<double, Tracker> OffsetMap;
+  typedef std::multimap<double, Group*> HeadMap;
+
+  struct Group {
+    double watermark;
+    OffsetMap absolute;
+    OffsetMap percent;
+    typename HeadMap::iterator head;
+    typename std::list<Group>::iterator self;
+  };
+
+  const double sign_;
+  std::list<Group> groups_;
+  HeadMap heads_;
+  size_t size_;
+
+  double absolute_trigger(const Group& group, double offset) const {
+    return group.watermark + sign_ * offset;
+  }
+
+  double percent_trigger(const Group& group, double offset) const {
+    return group.watermark * (1 + sign_ * offset);
+  }
+
+  bool triggers(double trigger_price, double price) const {
+    return sign_ * trigger_price <= sign_ * price;
+  }
+
+  /* a watermark of 0 means no trade happened since the order was added */
+  bool extends(double watermark, double price) const {
+    return watermark == 0 || sign_ * price < sign_ * watermark;
+  }
+
+  void update_head(Group& group);
+  void merge(Group& into, Group& from);
+  void collect(Group& group, double price, TrackerVec& out);
+};
+
+
+template <class Tracker>
+void TrailingStopIndex<Tracker>::add(
+  const Tracker& tracker,
+  double watermark,
+  TrailingType type,
+  double offset)
+{
+  if(groups_.empty() || groups_.back().watermark != watermark) {
+    groups_.emplace_back();
+    groups_.back().watermark = watermark;
+    groups_.back().head = heads_.end();
+    groups_.back().self = std::prev(groups_.end());
+  }
+
+  Group& group = groups_.back();
+  OffsetMap& offsets = type == trail_percent ? group.percent : group.absolute;
+  offsets.emplace(offset, tracker);
+  ++size_;
+
+  update_head(group);
+}
+
+
+template <class Tracker>
+void TrailingStopIndex<Tracker>::on_market_price_change(
+  double price, TrackerVec& out)
+{
+  /* merge every group whose watermark is extended by the new price.
+     these are necessarily the newest groups */
+  if(!groups_.empty() && extends(groups_.back().watermark, price)) {
+    auto last = std::prev(groups_.end());
+
+    while(last != groups_.begin() && extends(std::prev(last)->watermark, price)) {
+      auto prev = std::prev(last);
+      merge(*prev, *last);
+      groups_.erase(last);
+      last = prev;
+    }
+
+    last->watermark = price;
+    update_head(*last);
+  }
+
+  /* closest triggers first */
+  while(!heads_.empty() && heads_.begin()->first <= sign_ * price) {
+    collect(*heads_.begin()->second, price, out);
+  }
+}
+
+
+template <class Tracker>
+void TrailingStopIndex<Tracker>::drain(TrackerVec& out) {
+  for(auto& group : groups_) {
+    for(auto& entry : group.absolute)
+      out.push_back(std::move(entry.second));
+    for(auto& entry : group.percent)
+      out.push_back(std::move(entry.second));
+  }
+
+  groups_.clear();
+  heads_.clear();
+  size_ = 0;
+}
+
+
+template <class Tracker>
+void TrailingStopIndex<Tracker>::update_head(Group& group) {
+  if(group.head != heads_.end())
+    heads_.erase(group.head);
+
+  group.head = heads_.end();
+
+  bool has_absolute = !group.absolute.empty();
+  bool has_percent = !group.percent.empty();
+
+  if(!has_absolute && !has_percent) return;
+
+  double trigger_price;
+
+  if(has_absolute && has_percent) {
+    trigger_price = std::min(
+      sign_ * absolute_trigger(group, group.absolute.begin()->first),
+      sign_ * percent_trigger(group, group.percent.begin()->first));
+  }
+  else if(has_absolute)
+    trigger_price = sign_ * absolute_trigger(group, group.absolute.begin()->first);
+  else
+    trigger_price = sign_ * percent_trigger(group, group.percent.begin()->first);
+
+  group.head = heads_.emplace(trigger_price, &group);
+}
+
+
+/**
+ * \brief moves the orders of `from` into `into`, always inserting the
+ *  smaller map into the larger one so that each order is moved O(log n)
+ *  times over its lifetime
+ */
+
+template <class Tracker>
+void TrailingStopIndex<Tracker>::merge(Group& into, Group& from) {
+  if(from.head != heads_.end()) {
+    heads_.erase(from.head);
+    from.head = heads_.end();
+  }
+
+  OffsetMap* pairs[2][2] = {
+    { &into.absolute, &from.absolute },
+    { &into.percent, &from.percent }
+  };
+
+  for(auto& pair : pairs) {
+    OffsetMap& dst = *pair[0];
+    OffsetMap& src = *pair[1];
+
+    if(dst.size() < src.size())
+      dst.swap(src);
+
+    for(auto& entry : src)
+      dst.emplace(entry.first, std::move(entry.second));
+
+    src.clear();
+  }
+}
+
+
+template <class Tracker>
+void TrailingStopIndex<Tracker>::collect(
+  Group& group, double price, TrackerVec& out)
+{
+  while(!group.absolute.empty() &&
+    triggers(absolute_trigger(group, group.absolute.begin()->first), price))
+  {
+    out.push_back(std::move(group.absolute.begin()->second));
+    group.absolute.erase(group.absolute.begin());
+    --size_;
+  }
+
+  while(!group.percent.empty() &&
+    triggers(percent_trigger(group, group.percent.begin()->first), price))
+  {
+    out.push_back(std::move(group.percent.begin()->second));
+    group.percent.erase(group.percent.begin());
+    --size_;
+  }
+
+  if(group.absolute.empty() && group.percent.empty()) {
+    heads_.erase(group.head);
+    groups_.erase(group.self);
+  }
+  else
+    update_head(group);
+}
+
+}
+}
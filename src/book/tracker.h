@@ -7,7 +7,9 @@
 
 #include <stdexcept>
 #include <cassert>
+#include <cmath>
 #include "constants.h"
+#include "order.h"
 
 namespace book {
 
@@ -15,22 +17,24 @@ template <class Order>
 struct BaseTracker {
   typedef Order OrderPtr;
 
+  static_assert(is_order<Order>::value,
+    "orders must provide is_bid(), qty(), price() and funds(), see book/order.h");
+
   BaseTracker(const Order& order) :
-    is_bid_(order->is_bid()),
     price_(order->price()),
     qty_(order->qty()),
-    funds_(order->funds()),
     filled_qty_(0),
+    funds_(order->funds()),
     filled_cost_(0),
-    avg_price_(0),
+    is_bid_(order->is_bid()),
     order_(order) { }
-  
-  /* virtual destructor to make BaseTracker polymorphic */
-  virtual ~BaseTracker() = default;
 
   bool is_bid() const { return is_bid_; }
   double price() const { return price_; }
 
+  /* funds, not only qty, cap what the order can trade */
+  bool funds_limited() const { return funds_ != 0; }
+
   void fill(double fill_qty, double fill_cost) {
     if(funds_ != 0 && fill_cost + filled_cost_ > funds_) {
       throw std::runtime_error("Market buy fill exceeds funds");
@@ -40,7 +44,6 @@ struct BaseTracker {
       throw std::runtime_error("Fill qty exceeds order qty");
     }
 
-    avg_price_ = (avg_price_ * filled_qty_  + fill_cost) / (filled_qty_ + fill_qty); 
     filled_cost_ += fill_cost;
     filled_qty_ += fill_qty;
   }
@@ -68,10 +71,22 @@ struct BaseTracker {
 
     /* limiting factor is funds only */
     if(qty_ == 0)
-      return floor((funds_ - filled_cost_) / price / TRADE_QTY_INCREMENT) * TRADE_QTY_INCREMENT;
+      return funds_qty(price);
 
     /* limiting factors are both qty and funds */
-    return std::min(qty_ - filled_qty_, floor((funds_ - filled_cost_) / price / TRADE_QTY_INCREMENT) * TRADE_QTY_INCREMENT);
+    return std::min(qty_ - filled_qty_, funds_qty(price));
+  }
+
+  /* the qty the funds left can buy at `price`, rounded down to the
+     TRADE_QTY_INCREMENT. the division may round up, leaving the qty
+     an increment too costly for fill() */
+  double funds_qty(double price) const {
+    double qty = floor((funds_ - filled_cost_) / price / TRADE_QTY_INCREMENT) * TRADE_QTY_INCREMENT;
+
+    if(qty * price + filled_cost_ > funds_)
+      qty -= TRADE_QTY_INCREMENT;
+
+    return qty;
   }
 
   const Order& ptr() const {
@@ -86,8 +101,20 @@ struct BaseTracker {
     return filled_cost_;
   }
 
+  double funds() const {
+    return funds_;
+  }
+
+  /* derived on demand, keeping divisions out of fill() */
   double avg_price() const {
-    return avg_price_;
+    return filled_qty_ == 0 ? 0 : filled_cost_ / filled_qty_;
+  }
+
+  /* takes over the fills of the tracker of the order this one amends.
+     tracker mixins with state to carry over extend it */
+  void inherit(const BaseTracker& amended) {
+    filled_qty_ = amended.filled_qty_;
+    filled_cost_ = amended.filled_cost_;
   }
 
   void change_open_qty(double delta) {
@@ -98,15 +125,48 @@ struct BaseTracker {
   }
 
 protected:
-  const bool is_bid_;
+  /* read on every match first */
   double price_;
   double qty_;
-  const double funds_;
   double filled_qty_;
+  const double funds_;
   double filled_cost_;
-  double avg_price_;
+  const bool is_bid_;
   const Order order_;
 };
 
 
+template <class Base, template <class> class... Mixins>
+struct ApplyTrackerMixins {
+  typedef Base type;
+};
+
+template <class Base, template <class> class Mixin, template <class> class... Rest>
+struct ApplyTrackerMixins<Base, Mixin, Rest...> {
+  typedef typename ApplyTrackerMixins<Mixin<Base>, Rest...>::type type;
+};
+
+
+/*
+  Assembles the tracker of a book from the trackers of its plugins, e.g.
+
+    typedef ComposeTracker<OrderPtr,
+      SelfTradePolicyTracker, RoutableTracker> Tracker;
+
+  Plugin trackers are mixins, templates deriving from their argument, and
+  are stacked in a single inheritance chain over BaseTracker. The result has
+  no vtable and no virtual bases: every accessor is a direct, inlinable
+  load. Fields are laid out in chain order, BaseTracker first, so listing
+  the mixins read while matching first keeps the hot fields together.
+*/
+
+template <class Order, template <class> class... Mixins>
+struct ComposeTracker :
+public ApplyTrackerMixins<BaseTracker<Order>, Mixins...>::type {
+  typedef typename ApplyTrackerMixins<BaseTracker<Order>, Mixins...>::type Base;
+
+  ComposeTracker(const Order& order) : Base(order) {}
+};
+
+
 }
\ No newline at end of file
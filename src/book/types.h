@@ -15,7 +15,8 @@ enum InsertRejectReasons : uint8_t {
   insufficient_funds,
   qty_too_small,
   funds_too_small,
-  duplicate_client_order_id
+  duplicate_client_order_id,
+  book_halted
 };
 
 enum CancelRejectReasons : uint8_t {
@@ -27,7 +28,9 @@ enum ReplaceRejectReasons : uint8_t {
   dont_replace_reject,
   replace_reject_not_found,
   replace_reject_no_qty,
-  replace_insufficient_funds
+  replace_insufficient_funds,
+  replace_reject_invalid_price,
+  replace_reject_not_allowed /* a plugin rejected the amended order */
 };
 
 enum CancelReasons : uint8_t {
@@ -43,6 +46,7 @@ enum CancelReasons : uint8_t {
   reduce_only_close,
   mm_routed,
   routing_failure,  
+  order_expired,
 };
 
 
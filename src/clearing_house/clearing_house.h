@@ -0,0 +1,257 @@
+/*
+ *  Copyright (c) 2019-present, LBS Trading LLC. All rights reserved.
+ *  See the file LICENSE.md for licensing information.
+ */
+
+/*
+  Nets the balance changes of fills per user and asset, and hands them
+  out in batches.
+
+  A fill of `qty` at `price` on symbol base/quote (see utils/symbols.h)
+  moves `qty` base from the seller to the buyer and `qty * price` quote
+  the other way. The taker and the maker each pay a fee in quote, at the
+  rate of their tier in the FeeSchedule, to the fee account; a negative
+  maker rate is a rebate the fee account pays. Every fill nets to zero
+  per asset, the fee account included.
+
+  Deltas accumulate in a dense user x asset matrix, rows given to users
+  on their first fill and columns to assets on the first fill of a
+  symbol. A fill is a handful of additions, with no allocation once its
+  users and symbol are known. The cells touched since the last flush()
+  are listed, so that a flush is O(cells touched), and yields one
+  Settlement per user and asset however many fills there were: the
+  balance store is written once per batch, not once per fill.
+*/
+
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <stdexcept>
+#include <unordered_map>
+
+#include <book/callback.h>
+#include <utils/symbols.h>
+
+#include "fee_schedule.h"
+
+namespace clearing_house {
+
+struct Settlement {
+  uint64_t user_id;
+  uint32_t asset;
+  double delta;
+};
+
+class ClearingHouse {
+public:
+  /* `max_assets` bounds the distinct assets traded, as columns of the
+     matrix */
+  ClearingHouse(
+    uint32_t max_assets,
+    FeeSchedule schedule = FeeSchedule(),
+    uint64_t fee_user_id = 0) :
+    columns_(max_assets),
+    schedule_(std::move(schedule)),
+    fee_user_id_(fee_user_id),
+    fee_row_(row(fee_user_id)) {}
+
+  void on_trade(
+    uint32_t symbol_id,
+    uint64_t taker_user_id,
+    uint64_t maker_user_id,
+    bool taker_is_bid,
+    double qty,
+    double price)
+  {
+    const Columns& columns = symbol(symbol_id);
+    const uint32_t taker = row(taker_user_id);
+    const uint32_t maker = row(maker_user_id);
+    const uint32_t buyer = taker_is_bid ? taker : maker;
+    const uint32_t seller = taker_is_bid ? maker : taker;
+
+    const double notional = qty * price;
+
+    add(buyer, columns.base, qty);
+    add(seller, columns.base, -qty);
+    add(buyer, columns.quote, -notional);
+    add(seller, columns.quote, notional);
+
+    const double taker_fee = notional * schedule_.tier(users_[taker].tier).taker_rate;
+    const double maker_fee = notional * schedule_.tier(users_[maker].tier).maker_rate;
+
+    add(taker, columns.quote, -taker_fee);
+    add(maker, columns.quote, -maker_fee);
+    add(fee_row_, columns.quote, taker_fee + maker_fee);
+
+    trade_volume(taker, notional);
+    trade_volume(maker, notional);
+  }
+
+  /* settles the cb_trade and cb_level_fill callbacks of a book, whose
+     orders provide user_id(). `maker_fills` is the book's maker_fills().
+     callbacks not meant for external consumers are skipped: a routed
+     fill is matched internally first, and only settled once replayed
+     after its routing succeeded (see book/plugins/routable.h).
+     returns the number of fills settled */
+  template <class OrderPtr>
+  size_t on_callbacks(
+    uint32_t symbol_id,
+    const std::vector<book::Callback<OrderPtr>>& callbacks,
+    const std::vector<book::MakerFill<OrderPtr>>& maker_fills)
+  {
+    typedef book::Callback<OrderPtr> TypedCallback;
+    size_t fills = 0;
+
+    for(auto& cb : callbacks) {
+      if(!(cb.scope & TypedCallback::external_only)) continue;
+
+      if(cb.type == TypedCallback::cb_trade) {
+        on_trade(symbol_id, cb.order->user_id(), cb.maker_order->user_id(),
+          cb.order->is_bid(), cb.qty, cb.price);
+        ++fills;
+      }
+
+      else if(cb.type == TypedCallback::cb_level_fill) {
+        for(uint32_t i = 0; i < cb.fills_count; ++i) {
+          const book::MakerFill<OrderPtr>& fill = maker_fills[cb.fills_begin + i];
+          on_trade(symbol_id, cb.order->user_id(), fill.maker->user_id(),
+            cb.order->is_bid(), fill.qty, cb.price);
+        }
+        fills += cb.fills_count;
+      }
+    }
+
+    return fills;
+  }
+
+  /* appends the net deltas since the last flush to `out`, one per user
+     and asset, and starts a new batch. deltas that netted to zero are
+     left out. returns the number appended */
+  size_t flush(std::vector<Settlement>& out) {
+    size_t flushed = 0;
+    out.reserve(out.size() + touched_.size());
+
+    for(uint32_t cell : touched_) {
+      if(deltas_[cell] != 0) {
+        out.push_back(Settlement{
+          users_[cell / columns_].user_id, assets_[cell % columns_], deltas_[cell] });
+        ++flushed;
+      }
+
+      deltas_[cell] = 0;
+      is_touched_[cell] = false;
+    }
+
+    touched_.clear();
+    return flushed;
+  }
+
+  /* cells touched since the last flush */
+  size_t pending() const { return touched_.size(); }
+
+  double pending_delta(uint64_t user_id, uint32_t asset) const {
+    auto user = rows_.find(user_id);
+    auto column = columns_of_.find(asset);
+
+    if(user == rows_.end() || column == columns_of_.end()) return 0;
+    return deltas_[user->second * columns_ + column->second];
+  }
+
+  /* traded notional of the user, all symbols */
+  double volume(uint64_t user_id) const {
+    auto user = rows_.find(user_id);
+    return user == rows_.end() ? 0 : users_[user->second].volume;
+  }
+
+  size_t tier(uint64_t user_id) const {
+    auto user = rows_.find(user_id);
+    return user == rows_.end() ? 0 : users_[user->second].tier;
+  }
+
+  uint64_t fee_user_id() const { return fee_user_id_; }
+
+private:
+  struct User {
+    uint64_t user_id;
+    double volume;
+    uint32_t tier;
+  };
+
+  struct Columns {
+    uint32_t base;
+    uint32_t quote;
+  };
+
+  const uint32_t columns_;
+  const FeeSchedule schedule_;
+  const uint64_t fee_user_id_;
+
+  std::vector<User> users_;                       /* by row */
+  std::unordered_map<uint64_t, uint32_t> rows_;   /* user id -> row */
+  std::vector<uint32_t> assets_;                  /* by column */
+  std::unordered_map<uint32_t, uint32_t> columns_of_; /* asset -> column */
+  std::unordered_map<uint32_t, Columns> symbols_;
+
+  std::vector<double> deltas_;     /* row * columns_ + column */
+  std::vector<bool> is_touched_;   /* same layout */
+  std::vector<uint32_t> touched_;  /* cells, in order of first touch */
+
+  const uint32_t fee_row_;
+
+  uint32_t row(uint64_t user_id) {
+    auto it = rows_.find(user_id);
+    if(it != rows_.end()) return it->second;
+
+    const uint32_t row = (uint32_t)users_.size();
+    rows_.emplace(user_id, row);
+    users_.push_back(User{ user_id, 0, 0 });
+    deltas_.resize(deltas_.size() + columns_, 0);
+    is_touched_.resize(is_touched_.size() + columns_, false);
+
+    return row;
+  }
+
+  uint32_t column(uint32_t asset) {
+    auto it = columns_of_.find(asset);
+    if(it != columns_of_.end()) return it->second;
+
+    if(assets_.size() == columns_)
+      throw std::runtime_error("Too many assets for the clearing house");
+
+    const uint32_t column = (uint32_t)assets_.size();
+    columns_of_.emplace(asset, column);
+    assets_.push_back(asset);
+
+    return column;
+  }
+
+  const Columns& symbol(uint32_t symbol_id) {
+    auto it = symbols_.find(symbol_id);
+    if(it != symbols_.end()) return it->second;
+
+    Columns columns{
+      column(utils::stob(symbol_id)),
+      column(utils::stoq(symbol_id)) };
+
+    return symbols_.emplace(symbol_id, columns).first->second;
+  }
+
+  void add(uint32_t row, uint32_t column, double delta) {
+    const uint32_t cell = row * columns_ + column;
+    deltas_[cell] += delta;
+
+    if(!is_touched_[cell]) {
+      is_touched_[cell] = true;
+      touched_.push_back(cell);
+    }
+  }
+
+  void trade_volume(uint32_t row, double notional) {
+    User& user = users_[row];
+    user.volume += notional;
+    user.tier = (uint32_t)schedule_.promote(user.tier, user.volume);
+  }
+};
+
+}
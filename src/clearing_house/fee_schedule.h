@@ -0,0 +1,59 @@
+/*
+ *  Copyright (c) 2019-present, LBS Trading LLC. All rights reserved.
+ *  See the file LICENSE.md for licensing information.
+ */
+
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+
+#include <book/constants.h>
+
+namespace clearing_house {
+
+/* rates apply to the notional of a fill. a negative rate is a rebate */
+struct FeeTier {
+  double min_volume; /* traded notional from which the tier applies */
+  double taker_rate;
+  double maker_rate;
+};
+
+/*
+  Volume-tiered fees. A user's tier is the last one whose min_volume
+  their traded notional reaches. Tiers are sorted by min_volume on
+  construction, and the first must start at 0.
+*/
+
+class FeeSchedule {
+public:
+  /* a single tier at the book's default rates */
+  FeeSchedule() : tiers_{ FeeTier{ 0, book::TAKER_FEE_RATE, book::MAKER_FEE_RATE } } {}
+
+  FeeSchedule(std::vector<FeeTier> tiers) : tiers_(std::move(tiers)) {
+    std::sort(tiers_.begin(), tiers_.end(),
+      [](const FeeTier& lhs, const FeeTier& rhs) {
+        return lhs.min_volume < rhs.min_volume;
+      });
+
+    if(tiers_.empty() || tiers_[0].min_volume != 0)
+      throw std::invalid_argument("Fee schedule must have a tier from 0");
+  }
+
+  size_t size() const { return tiers_.size(); }
+  const FeeTier& tier(size_t i) const { return tiers_[i]; }
+
+  /* moves `tier` up for `volume`. tiers only ever go up, so this is
+     O(1) amortized when called on every fill */
+  size_t promote(size_t tier, double volume) const {
+    while(tier + 1 < tiers_.size() && volume >= tiers_[tier + 1].min_volume)
+      ++tier;
+    return tier;
+  }
+
+private:
+  std::vector<FeeTier> tiers_;
+};
+
+}
@@ -5,6 +5,8 @@
 #include <cmath>
 #include <array>
 
+#include <book/callback.h>
+
 #include "depth.h"
 #include "depth_level.h"
 
@@ -32,6 +34,15 @@ public:
     double price,
     bool taker_filled,
     bool maker_filled);
+
+  /* a cb_level_fill, applied as the fills of its makers. `fills` points
+     to its fills_count entries of the book's maker_fills() */
+  void on_level_fill(
+    const OrderPtr& order,
+    const book::MakerFill<OrderPtr>* fills,
+    uint32_t fills_count,
+    double fill_qty,
+    bool taker_filled);
   
   void on_cancel(
     const OrderPtr& order,
@@ -112,6 +123,33 @@ void DepthBook<OrderPtr, SIZE, PRECISION>::on_fill(
   }
 }
 
+template <class OrderPtr, int SIZE, int PRECISION>
+void DepthBook<OrderPtr, SIZE, PRECISION>::on_level_fill(
+  const OrderPtr& taker,
+  const book::MakerFill<OrderPtr>* fills,
+  uint32_t fills_count,
+  double fill_qty,
+  bool taker_filled)
+{
+  for(uint32_t i = 0; i < fills_count; ++i) {
+    const OrderPtr& maker = fills[i].maker;
+
+    depth_.fill_order(
+      aggregate(maker->is_bid(), maker->price()),
+      fills[i].qty,
+      true,
+      maker->is_bid());
+  }
+
+  if(taker->price() != 0) {
+    depth_.fill_order(
+      aggregate(taker->is_bid(), taker->price()),
+      fill_qty,
+      taker_filled,
+      taker->is_bid());
+  }
+}
+
 template <class OrderPtr, int SIZE, int PRECISION>
 void DepthBook<OrderPtr, SIZE, PRECISION>::on_cancel(
   const OrderPtr& order,
@@ -133,11 +171,15 @@ void DepthBook<OrderPtr, SIZE, PRECISION>::on_replace(
   const double effective_delta,
   const double new_price)
 {
-  double old_price = aggregate(order->is_bid(), order->price());
-
-  depth_.replace_order(  
-    old_price,
-    old_price,
+  /* order is the order as it was on the book, new_price is 0 unless
+     it was amended to another price */
+  double current_price = aggregate(order->is_bid(), order->price());
+  double price = new_price == 0 ?
+    current_price : aggregate(order->is_bid(), new_price);
+
+  depth_.replace_order(
+    current_price,
+    price,
     current_qty_on_book,
     effective_delta,
     order->is_bid());
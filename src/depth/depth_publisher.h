@@ -0,0 +1,211 @@
+/*
+  Publishes the top levels of each symbol's Depth into shared memory,
+  for readers on the same host.
+
+  The region holds one slot per symbol, each guarded by a seqlock. The
+  writer makes the sequence odd, copies the levels, BBO and market price
+  in, then makes it even again. A reader copies the slot out and keeps the
+  copy if the sequence was even and unchanged across it, retrying
+  otherwise. Readers map the region read-only, never write to it and never
+  make a syscall, and the writer never waits for them.
+
+  Slots are cache-line aligned, so that publishing a symbol doesn't
+  disturb readers of another.
+*/
+
+#pragma once
+
+#include <new>
+#include <atomic>
+#include <string>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+#include <utils/ts.h>
+#include <utils/shm_region.h>
+
+#include "depth.h"
+
+namespace depth {
+
+struct PublishedLevel {
+  double price; /* 0 for an empty level */
+  double qty;
+  uint32_t order_count;
+  uint32_t reserved;
+};
+
+template <int LEVELS>
+struct DepthSnapshot {
+  uint32_t symbol_id;
+  uint32_t levels;
+  uint64_t ts; /* utils::ts_ns() of the publication */
+  double market_price;
+  double bid_price;
+  double bid_qty;
+  double ask_price;
+  double ask_qty;
+  PublishedLevel bids[LEVELS];
+  PublishedLevel asks[LEVELS];
+};
+
+template <int LEVELS>
+struct alignas(64) DepthSlot {
+  std::atomic<uint64_t> seq; /* odd while being written */
+  DepthSnapshot<LEVELS> snapshot;
+};
+
+struct DepthRegionHeader {
+  enum : uint64_t { MAGIC = 0x485450454453424full }; /* "OBSDEPTH" */
+  enum : uint32_t { VERSION = 1 };
+
+  uint64_t magic;
+  uint32_t version;
+  uint32_t levels;
+  uint32_t symbols;
+  uint32_t slot_size;
+  char padding[40];
+};
+
+static_assert(sizeof(DepthRegionHeader) == 64, "depth region header is a cache line");
+
+
+/* `LEVELS` levels of each side of a Depth<SIZE> are published, LEVELS <= SIZE */
+template <int SIZE, int LEVELS = SIZE>
+class DepthPublisher {
+public:
+  static_assert(LEVELS <= SIZE, "can't publish more levels than tracked");
+
+  typedef DepthSlot<LEVELS> Slot;
+
+  /* creates the region, with room for `symbols` slots */
+  DepthPublisher(const std::string& name, uint32_t symbols) :
+    region_(name, sizeof(DepthRegionHeader) + symbols * sizeof(Slot), true, true),
+    slots_(reinterpret_cast<Slot*>(region_.base() + sizeof(DepthRegionHeader))),
+    symbols_(symbols)
+  {
+    for(uint32_t i = 0; i < symbols; ++i) {
+      new (&slots_[i]) Slot();
+      slots_[i].seq.store(0, std::memory_order_relaxed);
+    }
+
+    DepthRegionHeader* header = reinterpret_cast<DepthRegionHeader*>(region_.base());
+    header->version = DepthRegionHeader::VERSION;
+    header->levels = LEVELS;
+    header->symbols = symbols;
+    header->slot_size = sizeof(Slot);
+
+    /* readers check the magic last */
+    std::atomic_thread_fence(std::memory_order_release);
+    header->magic = DepthRegionHeader::MAGIC;
+  }
+
+  void publish(
+    uint32_t slot,
+    uint32_t symbol_id,
+    const Depth<SIZE>& depth,
+    double market_price)
+  {
+    if(slot >= symbols_)
+      throw std::out_of_range("Depth slot out of range");
+
+    Slot& out = slots_[slot];
+    const uint64_t seq = out.seq.load(std::memory_order_relaxed);
+
+    out.seq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    DepthSnapshot<LEVELS>& snapshot = out.snapshot;
+    snapshot.symbol_id = symbol_id;
+    snapshot.levels = LEVELS;
+    snapshot.ts = utils::ts_ns();
+    snapshot.market_price = market_price;
+
+    copy_levels(depth.bids(), snapshot.bids);
+    copy_levels(depth.asks(), snapshot.asks);
+
+    snapshot.bid_price = snapshot.bids[0].price;
+    snapshot.bid_qty = snapshot.bids[0].qty;
+    snapshot.ask_price = snapshot.asks[0].price;
+    snapshot.ask_qty = snapshot.asks[0].qty;
+
+    out.seq.store(seq + 2, std::memory_order_release);
+  }
+
+  uint32_t symbols() const { return symbols_; }
+
+private:
+  utils::ShmRegion region_;
+  Slot* slots_;
+  const uint32_t symbols_;
+
+  static void copy_levels(const DepthLevel* levels, PublishedLevel* out) {
+    for(int i = 0; i < LEVELS; ++i) {
+      out[i].price = levels[i].price();
+      out[i].qty = levels[i].aggregate_qty();
+      out[i].order_count = levels[i].order_count();
+      out[i].reserved = 0;
+    }
+  }
+};
+
+
+template <int LEVELS>
+class DepthReader {
+public:
+  typedef DepthSlot<LEVELS> Slot;
+
+  /* maps a publisher's region read-only */
+  DepthReader(const std::string& name) :
+    region_(name, 0, false, false)
+  {
+    const DepthRegionHeader* header =
+      reinterpret_cast<const DepthRegionHeader*>(region_.base());
+
+    if(region_.size() < sizeof(DepthRegionHeader) ||
+      header->magic != DepthRegionHeader::MAGIC ||
+      header->version != DepthRegionHeader::VERSION ||
+      header->levels != LEVELS ||
+      header->slot_size != sizeof(Slot))
+      throw std::runtime_error("Not a depth region of this layout");
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    slots_ = reinterpret_cast<const Slot*>(region_.base() + sizeof(DepthRegionHeader));
+    symbols_ = header->symbols;
+  }
+
+  /* copies a consistent snapshot of `slot` to `out`. returns its
+     sequence, 0 if nothing was published to the slot yet */
+  uint64_t read(uint32_t slot, DepthSnapshot<LEVELS>& out) const {
+    if(slot >= symbols_)
+      throw std::out_of_range("Depth slot out of range");
+
+    const Slot& in = slots_[slot];
+
+    for(;;) {
+      const uint64_t before = in.seq.load(std::memory_order_acquire);
+      if(before & 1) continue;
+
+      memcpy(&out, &in.snapshot, sizeof(out));
+
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if(in.seq.load(std::memory_order_relaxed) == before)
+        return before / 2;
+    }
+  }
+
+  /* sequence of the last publication of `slot`, to poll for changes */
+  uint64_t version(uint32_t slot) const {
+    return slots_[slot].seq.load(std::memory_order_acquire) / 2;
+  }
+
+  uint32_t symbols() const { return symbols_; }
+
+private:
+  utils::ShmRegion region_;
+  const Slot* slots_;
+  uint32_t symbols_;
+};
+
+}
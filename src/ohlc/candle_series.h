@@ -0,0 +1,149 @@
+/*
+ *  Copyright (c) 2019-present, LBS Trading LLC. All rights reserved.
+ *  See the file LICENSE.md for licensing information.
+ */
+
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+namespace ohlc {
+
+struct Candle {
+  uint64_t open_ts; /* start of the interval, ns since epoch */
+  double open;
+  double high;
+  double low;
+  double close;
+  double volume;
+  double notional; /* sum of price * qty */
+  uint32_t trades;
+
+  double vwap() const { return volume == 0 ? 0 : notional / volume; }
+};
+
+
+/*
+  The candles of one interval, in a rolling buffer of the last
+  `capacity` of them.
+
+  A trade updates the last candle, or starts the next one when it falls
+  past its interval: O(1), no allocation, the buffer being sized once.
+  Intervals without trades get no candle. A trade older than the last
+  candle (out of order across feeds) is counted in the last candle.
+
+  Candles are contiguous in memory, oldest to newest, with a single
+  wrap, so a range of them is copied out with two memcpy at most.
+*/
+
+class CandleSeries {
+public:
+  /* `capacity` is rounded up to a power of two */
+  CandleSeries(uint64_t interval_ns, size_t capacity) :
+    interval_ns_(interval_ns),
+    candles_(round_up(capacity)),
+    mask_(candles_.size() - 1),
+    count_(0),
+    next_open_ts_(0)
+  {
+    if(interval_ns == 0)
+      throw std::invalid_argument("Candle interval must not be zero");
+  }
+
+  void on_trade(uint64_t ts, double price, double qty) {
+    if(count_ == 0 || ts >= next_open_ts_) {
+      const uint64_t open_ts = ts - ts % interval_ns_;
+      next_open_ts_ = open_ts + interval_ns_;
+
+      Candle& candle = candles_[count_++ & mask_];
+      candle.open_ts = open_ts;
+      candle.open = candle.high = candle.low = candle.close = price;
+      candle.volume = qty;
+      candle.notional = price * qty;
+      candle.trades = 1;
+      return;
+    }
+
+    Candle& candle = candles_[(count_ - 1) & mask_];
+    if(price > candle.high) candle.high = price;
+    if(price < candle.low) candle.low = price;
+    candle.close = price;
+    candle.volume += qty;
+    candle.notional += price * qty;
+    ++candle.trades;
+  }
+
+  /* folds `trades` trades at the same price into the series at once */
+  void on_trades(uint64_t ts, double price, double qty, uint32_t trades) {
+    on_trade(ts, price, qty);
+    candles_[(count_ - 1) & mask_].trades += trades - 1;
+  }
+
+  uint64_t interval_ns() const { return interval_ns_; }
+  size_t capacity() const { return candles_.size(); }
+
+  /* candles retained */
+  size_t size() const {
+    return count_ < candles_.size() ? count_ : candles_.size();
+  }
+
+  bool empty() const { return count_ == 0; }
+
+  /* 0 is the oldest retained candle */
+  const Candle& at(size_t i) const {
+    return candles_[(count_ - size() + i) & mask_];
+  }
+
+  /* the current candle, empty() must be false */
+  const Candle& last() const { return candles_[(count_ - 1) & mask_]; }
+
+  /* copies the retained candles opened in [from_ts, to_ts), oldest
+     first, up to `max` of them. returns the number copied */
+  size_t query(uint64_t from_ts, uint64_t to_ts, Candle* out, size_t max) const {
+    const size_t begin = lower_bound(from_ts);
+    size_t end = lower_bound(to_ts);
+
+    if(end - begin > max) end = begin + max;
+    if(begin >= end) return 0;
+
+    const size_t first = (count_ - size() + begin) & mask_;
+    const size_t n = end - begin;
+    const size_t head = n < candles_.size() - first ? n : candles_.size() - first;
+
+    memcpy(out, &candles_[first], head * sizeof(Candle));
+    memcpy(out + head, &candles_[0], (n - head) * sizeof(Candle));
+
+    return n;
+  }
+
+private:
+  const uint64_t interval_ns_;
+  std::vector<Candle> candles_;
+  const size_t mask_;
+  uint64_t count_;        /* candles started, ever */
+  uint64_t next_open_ts_; /* end of the last candle's interval */
+
+  /* index of the first retained candle opened at or after `ts` */
+  size_t lower_bound(uint64_t ts) const {
+    size_t lo = 0, hi = size();
+
+    while(lo < hi) {
+      const size_t mid = (lo + hi) / 2;
+      if(at(mid).open_ts < ts) lo = mid + 1;
+      else hi = mid;
+    }
+
+    return lo;
+  }
+
+  static size_t round_up(size_t n) {
+    size_t capacity = 1;
+    while(capacity < n) capacity <<= 1;
+    return capacity;
+  }
+};
+
+}
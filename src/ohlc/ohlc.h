@@ -0,0 +1,160 @@
+/*
+ *  Copyright (c) 2019-present, LBS Trading LLC. All rights reserved.
+ *  See the file LICENSE.md for licensing information.
+ */
+
+/*
+  OHLCV and VWAP candles of many intervals per symbol, built as trades
+  come in.
+
+  Each symbol has one CandleSeries per interval, all allocated when the
+  symbol is first seen (or add_symbol() is called): a trade then costs
+  one lookup of the symbol and O(1) per interval, with no allocation.
+
+  on_callbacks() takes a book's callbacks as they are, counting the
+  cb_trade and cb_level_fill meant for external consumers, and stamps candles with the wall clock time of the
+  callbacks (utils::to_wall_ns()), so that intervals are aligned on the
+  epoch: a day candle opens at midnight UTC.
+*/
+
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <stdexcept>
+#include <unordered_map>
+
+#include <book/callback.h>
+#include <utils/ts.h>
+
+#include "candle_series.h"
+
+namespace ohlc {
+
+const uint64_t NS_PER_SECOND = 1000000000ull;
+const uint64_t NS_PER_MINUTE = 60 * NS_PER_SECOND;
+const uint64_t NS_PER_HOUR = 60 * NS_PER_MINUTE;
+const uint64_t NS_PER_DAY = 24 * NS_PER_HOUR;
+
+/* candles kept per interval, unless given */
+const size_t DEFAULT_CANDLES_CAPACITY = 1024;
+
+/* 1s, 1m, 5m, 15m, 1h, 4h and 1d */
+inline std::vector<uint64_t> default_intervals() {
+  return std::vector<uint64_t>{
+    NS_PER_SECOND,
+    NS_PER_MINUTE,
+    5 * NS_PER_MINUTE,
+    15 * NS_PER_MINUTE,
+    NS_PER_HOUR,
+    4 * NS_PER_HOUR,
+    NS_PER_DAY
+  };
+}
+
+class OHLC {
+public:
+  OHLC(
+    const std::vector<uint64_t>& intervals_ns = default_intervals(),
+    size_t capacity = DEFAULT_CANDLES_CAPACITY) :
+    intervals_ns_(intervals_ns),
+    capacity_(capacity)
+  {
+    if(intervals_ns.empty())
+      throw std::invalid_argument("OHLC needs at least one interval");
+  }
+
+  /* allocates the candles of a symbol ahead of its first trade */
+  void add_symbol(uint32_t symbol_id) {
+    symbol(symbol_id);
+  }
+
+  void on_trade(uint32_t symbol_id, uint64_t ts, double price, double qty) {
+    for(auto& series : symbol(symbol_id))
+      series.on_trade(ts, price, qty);
+  }
+
+  /* trades of the internal_only scope are left out: a routed fill is
+     counted once replayed after its routing succeeded, a fill of a
+     failed leg never (see book/plugins/routable.h).
+     returns the number of trades counted */
+  template <class OrderPtr>
+  size_t on_callbacks(
+    uint32_t symbol_id,
+    const std::vector<book::Callback<OrderPtr>>& callbacks)
+  {
+    typedef book::Callback<OrderPtr> TypedCallback;
+
+    size_t trades = 0;
+    Series* all = nullptr;
+
+    for(auto& cb : callbacks) {
+      if(cb.type != TypedCallback::cb_trade &&
+        cb.type != TypedCallback::cb_level_fill) continue;
+
+      if(!(cb.scope & TypedCallback::external_only)) continue;
+
+      if(!all) all = &symbol(symbol_id);
+
+      /* a level fill is one trade per maker, all at its price */
+      const uint32_t count = cb.type == TypedCallback::cb_trade ? 1 : cb.fills_count;
+      const uint64_t ts = utils::to_wall_ns(cb.ts);
+
+      for(auto& series : *all)
+        series.on_trades(ts, cb.price, cb.qty, count);
+
+      trades += count;
+    }
+
+    return trades;
+  }
+
+  const std::vector<uint64_t>& intervals_ns() const { return intervals_ns_; }
+
+  bool has_symbol(uint32_t symbol_id) const {
+    return symbols_.find(symbol_id) != symbols_.end();
+  }
+
+  /* throws std::out_of_range if the symbol or interval is unknown */
+  const CandleSeries& series(uint32_t symbol_id, uint64_t interval_ns) const {
+    const Series& all = symbols_.at(symbol_id);
+
+    for(auto& series : all)
+      if(series.interval_ns() == interval_ns) return series;
+
+    throw std::out_of_range("Unknown candle interval");
+  }
+
+  /* see CandleSeries::query() */
+  size_t query(
+    uint32_t symbol_id,
+    uint64_t interval_ns,
+    uint64_t from_ts,
+    uint64_t to_ts,
+    Candle* out,
+    size_t max) const
+  {
+    return series(symbol_id, interval_ns).query(from_ts, to_ts, out, max);
+  }
+
+private:
+  typedef std::vector<CandleSeries> Series;
+
+  const std::vector<uint64_t> intervals_ns_;
+  const size_t capacity_;
+  std::unordered_map<uint32_t, Series> symbols_;
+
+  Series& symbol(uint32_t symbol_id) {
+    auto it = symbols_.find(symbol_id);
+    if(it != symbols_.end()) return it->second;
+
+    Series& all = symbols_[symbol_id];
+    all.reserve(intervals_ns_.size());
+    for(uint64_t interval_ns : intervals_ns_)
+      all.emplace_back(interval_ns, capacity_);
+
+    return all;
+  }
+};
+
+}
@@ -0,0 +1,229 @@
+/*
+ *  Copyright (c) 2019-present, LBS Trading LLC. All rights reserved.
+ *  See the file LICENSE.md for licensing information.
+ */
+
+/*
+  Replays recorded order flow through a book type, one OB per symbol.
+
+  Books of different symbols share nothing, so the stream is partitioned
+  by symbol and the shards are replayed in parallel on a work-stealing
+  pool, largest first. Each callback is tagged with the index of the
+  command that produced it. Outputs are merged back in command order,
+  so the result is the same, field for field, as replaying the stream on
+  one thread:
+
+  - within a shard, commands are replayed in their recorded order
+  - callback timestamps are cleared, being the only field that depends
+    on when the replay runs
+  - the makers of cb_level_fill callbacks are copied into the result,
+    and fills_begin is rebased on it
+
+  Orders are shared with the books, which only read them.
+*/
+
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <unordered_map>
+
+#include <book/types.h>
+#include <book/callback.h>
+#include <utils/thread_pool.h>
+
+namespace replay {
+
+template <class OrderPtr>
+struct Command {
+  enum Type : uint8_t {
+    add,
+    cancel,
+    replace
+  };
+
+  Type type;
+  uint32_t symbol_id;
+  OrderPtr order;
+  double delta;               /* replace only */
+  book::CancelReasons reason; /* cancel only */
+
+  static Command add_order(uint32_t symbol_id, const OrderPtr& order) {
+    return Command{ add, symbol_id, order, 0, book::dont_cancel };
+  }
+
+  static Command cancel_order(uint32_t symbol_id, const OrderPtr& order,
+    book::CancelReasons reason = book::user_cancel)
+  {
+    return Command{ cancel, symbol_id, order, 0, reason };
+  }
+
+  static Command replace_order(uint32_t symbol_id, const OrderPtr& order,
+    double delta)
+  {
+    return Command{ replace, symbol_id, order, delta, book::dont_cancel };
+  }
+};
+
+template <class OrderPtr>
+struct Output {
+  uint64_t seq; /* index of the command in the stream */
+  book::Callback<OrderPtr> callback;
+};
+
+template <class OrderPtr>
+struct Result {
+  std::vector<Output<OrderPtr>> outputs;
+  std::vector<book::MakerFill<OrderPtr>> maker_fills;
+};
+
+
+/* `Book` is an OB<Tracker, Plugins...> */
+template <class Book>
+class Replay {
+public:
+  typedef typename Book::OrderPtr OrderPtr;
+  typedef replay::Command<OrderPtr> Command;
+  typedef replay::Output<OrderPtr> Output;
+  typedef replay::Result<OrderPtr> Result;
+
+  /* threads == 0 replays the shards one after another on the caller's
+     thread */
+  static Result run(const std::vector<Command>& commands, size_t threads) {
+    std::vector<Shard> shards;
+    std::vector<uint32_t> shard_of(commands.size());
+    std::unordered_map<uint32_t, uint32_t> shard_ids;
+
+    for(size_t seq = 0; seq < commands.size(); ++seq) {
+      auto id = shard_ids.emplace(commands[seq].symbol_id, (uint32_t)shards.size());
+      if(id.second) shards.emplace_back(commands[seq].symbol_id);
+
+      shard_of[seq] = id.first->second;
+      shards[id.first->second].commands.push_back(seq);
+    }
+
+    if(threads == 0) {
+      for(auto& shard : shards) shard.run(commands);
+    }
+    else {
+      std::vector<Shard*> by_size;
+      for(auto& shard : shards) by_size.push_back(&shard);
+
+      std::stable_sort(by_size.begin(), by_size.end(),
+        [](const Shard* a, const Shard* b) {
+          return a->commands.size() > b->commands.size();
+        });
+
+      utils::ThreadPool pool(threads);
+      for(Shard* shard : by_size)
+        pool.submit([shard, &commands]() { shard->run(commands); });
+
+      pool.wait();
+    }
+
+    return merge(commands, shards, shard_of);
+  }
+
+private:
+  class ShardBook : public Book {
+  public:
+    typedef typename Book::Callbacks Callbacks;
+
+    ShardBook(uint32_t symbol_id, Result& result) :
+      Book(symbol_id), seq(0), result_(result) {}
+
+    uint64_t seq;
+
+  protected:
+    void on_callbacks(const Callbacks& callbacks) {
+      for(auto& callback : callbacks) {
+        result_.outputs.push_back(Output{ seq, callback });
+        book::Callback<OrderPtr>& cb = result_.outputs.back().callback;
+        cb.ts = 0;
+
+        if(cb.type == book::Callback<OrderPtr>::cb_level_fill) {
+          auto first = this->maker_fills().begin() + cb.fills_begin;
+          cb.fills_begin = result_.maker_fills.size();
+          result_.maker_fills.insert(result_.maker_fills.end(),
+            first, first + cb.fills_count);
+        }
+      }
+    }
+
+  private:
+    Result& result_;
+  };
+
+  struct Shard {
+    Shard(uint32_t symbol_id_) : symbol_id(symbol_id_) {}
+
+    uint32_t symbol_id;
+    std::vector<size_t> commands;
+    Result result;
+
+    void run(const std::vector<Command>& stream) {
+      std::unique_ptr<ShardBook> book(new ShardBook(symbol_id, result));
+
+      for(size_t seq : commands) {
+        const Command& command = stream[seq];
+        book->seq = seq;
+
+        switch(command.type) {
+          case Command::add:
+            book->add(command.order);
+            break;
+          case Command::cancel:
+            book->cancel(command.order, command.reason);
+            break;
+          case Command::replace:
+            book->replace(command.order, command.delta);
+            break;
+        }
+      }
+    }
+  };
+
+  /* walks the stream in order, taking each command's outputs from its
+     shard */
+  static Result merge(
+    const std::vector<Command>& commands,
+    std::vector<Shard>& shards,
+    const std::vector<uint32_t>& shard_of)
+  {
+    Result merged;
+    size_t outputs = 0, maker_fills = 0;
+
+    for(auto& shard : shards) {
+      outputs += shard.result.outputs.size();
+      maker_fills += shard.result.maker_fills.size();
+    }
+
+    merged.outputs.reserve(outputs);
+    merged.maker_fills.reserve(maker_fills);
+
+    std::vector<size_t> next(shards.size(), 0);
+
+    for(size_t seq = 0; seq < commands.size(); ++seq) {
+      const uint32_t id = shard_of[seq];
+      Result& result = shards[id].result;
+      size_t& i = next[id];
+
+      for(; i < result.outputs.size() && result.outputs[i].seq == seq; ++i) {
+        merged.outputs.push_back(result.outputs[i]);
+        book::Callback<OrderPtr>& cb = merged.outputs.back().callback;
+
+        if(cb.type == book::Callback<OrderPtr>::cb_level_fill) {
+          auto first = result.maker_fills.begin() + cb.fills_begin;
+          cb.fills_begin = merged.maker_fills.size();
+          merged.maker_fills.insert(merged.maker_fills.end(),
+            first, first + cb.fills_count);
+        }
+      }
+    }
+
+    return merged;
+  }
+};
+
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <array>
+#include <cassert>
+#include <cstddef>
+
+namespace utils {
+
+/* vector with inline storage and a compile-time capacity */
+
+template <class T, size_t N>
+class FixedVector {
+public:
+  typedef T* iterator;
+  typedef const T* const_iterator;
+
+  FixedVector() : size_(0) {}
+
+  void push_back(const T& value) {
+    assert(size_ < N);
+    items_[size_++] = value;
+  }
+
+  void clear() { size_ = 0; }
+
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+  bool full() const { return size_ == N; }
+  static constexpr size_t capacity() { return N; }
+
+  T& operator[](size_t i) { return items_[i]; }
+  const T& operator[](size_t i) const { return items_[i]; }
+
+  T& back() { return items_[size_ - 1]; }
+  const T& back() const { return items_[size_ - 1]; }
+
+  iterator begin() { return items_.data(); }
+  iterator end() { return items_.data() + size_; }
+  const_iterator begin() const { return items_.data(); }
+  const_iterator end() const { return items_.data() + size_; }
+
+private:
+  std::array<T, N> items_;
+  size_t size_;
+};
+
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+namespace utils {
+
+/* open-addressing hash set (linear probing, backward-shift deletion).
+ * kept at most half full; only grows past the capacity it was built with */
+
+template <class Key, class Hash>
+class FlatSet {
+public:
+  FlatSet(size_t capacity = 16) : size_(0) {
+    size_t buckets = 16;
+    while(buckets < capacity * 2) buckets <<= 1;
+    rehash(buckets);
+  }
+
+  /* returns false if the key was already present */
+  bool insert(const Key& key) {
+    if((size_ + 1) * 2 > entries_.size())
+      rehash(entries_.size() * 2);
+
+    size_t i = probe(key);
+    if(entries_[i].used) return false;
+
+    entries_[i].key = key;
+    entries_[i].used = true;
+    ++size_;
+    return true;
+  }
+
+  /* returns false if the key was not present */
+  bool erase(const Key& key) {
+    size_t i = probe(key);
+    if(!entries_[i].used) return false;
+
+    --size_;
+
+    const size_t mask = entries_.size() - 1;
+    size_t hole = i;
+
+    for(size_t j = (i + 1) & mask; entries_[j].used; j = (j + 1) & mask) {
+      size_t home = bucket(entries_[j].key);
+
+      if(((j - home) & mask) >= ((j - hole) & mask)) {
+        entries_[hole] = entries_[j];
+        hole = j;
+      }
+    }
+
+    entries_[hole].used = false;
+    return true;
+  }
+
+  size_t count(const Key& key) const {
+    return entries_[probe(key)].used ? 1 : 0;
+  }
+
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+private:
+  struct Entry {
+    Entry() : key(), used(false) {}
+
+    Key key;
+    bool used;
+  };
+
+  std::vector<Entry> entries_;
+  size_t size_;
+  Hash hash_;
+
+  size_t bucket(const Key& key) const {
+    return hash_(key) & (entries_.size() - 1);
+  }
+
+  size_t probe(const Key& key) const {
+    const size_t mask = entries_.size() - 1;
+    size_t i = bucket(key);
+
+    while(entries_[i].used && !(entries_[i].key == key))
+      i = (i + 1) & mask;
+
+    return i;
+  }
+
+  void rehash(size_t buckets) {
+    std::vector<Entry> old;
+    old.swap(entries_);
+    entries_.resize(buckets);
+
+    for(auto& entry : old)
+      if(entry.used) entries_[probe(entry.key)] = entry;
+  }
+};
+
+}
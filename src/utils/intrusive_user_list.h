@@ -0,0 +1,132 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <unordered_map>
+
+namespace utils {
+
+const uint32_t NULL_USER_NODE = UINT32_MAX;
+
+/* intrusive lists of values per user, `LISTS` of them per user (e.g. one
+ * per side of the book).
+ *
+ * nodes live in a vector and are recycled, so linking doesn't allocate
+ * once the storage has grown. link() returns the node, which its owner
+ * keeps to unlink it in O(1). a user is forgotten once all its lists are
+ * empty.
+ *
+ * a list is walked with head() and next(). unlinking a node doesn't
+ * move the others: a walk that unlinks the current node reads the next
+ * one beforehand. */
+
+template <class T, size_t LISTS = 1>
+class IntrusiveUserList {
+public:
+  uint32_t link(uint64_t user_id, const T& value, uint32_t list = 0) {
+    uint32_t node;
+
+    if(!free_nodes_.empty()) {
+      node = free_nodes_.back();
+      free_nodes_.pop_back();
+    } else {
+      node = (uint32_t)nodes_.size();
+      nodes_.emplace_back();
+    }
+
+    uint32_t& head = heads_[user_id].head[list];
+
+    Node& n = nodes_[node];
+    n.value = value;
+    n.user_id = user_id;
+    n.list = list;
+    n.prev = NULL_USER_NODE;
+    n.next = head;
+
+    if(n.next != NULL_USER_NODE)
+      nodes_[n.next].prev = node;
+
+    head = node;
+    return node;
+  }
+
+  void unlink(uint32_t node) {
+    Node& n = nodes_[node];
+
+    if(n.next != NULL_USER_NODE)
+      nodes_[n.next].prev = n.prev;
+
+    if(n.prev != NULL_USER_NODE)
+      nodes_[n.prev].next = n.next;
+    else {
+      auto heads = heads_.find(n.user_id);
+      heads->second.head[n.list] = n.next;
+
+      if(heads->second.empty())
+        heads_.erase(heads);
+    }
+
+    free_nodes_.push_back(node);
+  }
+
+  /* first node of a list of the user, NULL_USER_NODE if it's empty */
+  uint32_t head(uint64_t user_id, uint32_t list = 0) const {
+    auto heads = heads_.find(user_id);
+    return heads == heads_.end() ? NULL_USER_NODE : heads->second.head[list];
+  }
+
+  uint32_t next(uint32_t node) const { return nodes_[node].next; }
+  const T& value(uint32_t node) const { return nodes_[node].value; }
+
+  /* number of nodes in all the lists of the user */
+  size_t size(uint64_t user_id) const {
+    size_t size = 0;
+
+    auto heads = heads_.find(user_id);
+    if(heads == heads_.end()) return 0;
+
+    for(uint32_t head : heads->second.head)
+      for(uint32_t node = head; node != NULL_USER_NODE; node = nodes_[node].next)
+        ++size;
+
+    return size;
+  }
+
+  void clear() {
+    nodes_.clear();
+    free_nodes_.clear();
+    heads_.clear();
+  }
+
+private:
+  struct Node {
+    T value;
+    uint64_t user_id;
+    uint32_t prev;
+    uint32_t next;
+    uint32_t list;
+  };
+
+  struct Heads {
+    Heads() {
+      for(uint32_t& node : head) node = NULL_USER_NODE;
+    }
+
+    bool empty() const {
+      for(uint32_t node : head)
+        if(node != NULL_USER_NODE) return false;
+      return true;
+    }
+
+    uint32_t head[LISTS];
+  };
+
+  std::vector<Node> nodes_;
+  std::vector<uint32_t> free_nodes_;
+
+  /* user id -> first node of each list */
+  std::unordered_map<uint64_t, Heads> heads_;
+};
+
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstdint>
+#include <cassert>
+#include <vector>
+#include <memory>
+#include <utility>
+#include <type_traits>
+
+namespace utils {
+
+/* fixed-capacity pool of objects addressed by slot index.
+ * storage is allocated once; acquiring and releasing never allocate.
+ * acquire() hands out slots round-robin; acquire_at() lets the caller
+ * pick the slot, e.g. to derive it from an id */
+
+template <class T>
+class ObjectPool {
+public:
+  enum : uint32_t { npos = UINT32_MAX };
+
+  ObjectPool(uint32_t capacity) :
+    storage_(new Storage[capacity]),
+    live_(capacity, false),
+    capacity_(capacity),
+    size_(0),
+    cursor_(0) { }
+
+  ~ObjectPool() {
+    for(uint32_t slot = 0; slot < capacity_; ++slot)
+      if(live_[slot]) release(slot);
+  }
+
+  ObjectPool(const ObjectPool&) = delete;
+  ObjectPool& operator=(const ObjectPool&) = delete;
+
+  /* constructs a T in the next free slot. returns npos if the pool is full */
+  template <class... Args>
+  uint32_t acquire(Args&&... args) {
+    if(full()) return npos;
+
+    while(live_[cursor_])
+      cursor_ = cursor_ + 1 == capacity_ ? 0 : cursor_ + 1;
+
+    uint32_t slot = cursor_;
+    acquire_at(slot, std::forward<Args>(args)...);
+    return slot;
+  }
+
+  /* constructs a T in a given free slot */
+  template <class... Args>
+  void acquire_at(uint32_t slot, Args&&... args) {
+    assert(!live_[slot]);
+
+    new (&storage_[slot]) T(std::forward<Args>(args)...);
+    live_[slot] = true;
+    ++size_;
+  }
+
+  void release(uint32_t slot) {
+    (*this)[slot].~T();
+    live_[slot] = false;
+    --size_;
+  }
+
+  T& operator[](uint32_t slot) {
+    return *reinterpret_cast<T*>(&storage_[slot]);
+  }
+
+  const T& operator[](uint32_t slot) const {
+    return *reinterpret_cast<const T*>(&storage_[slot]);
+  }
+
+  bool live(uint32_t slot) const { return slot < capacity_ && live_[slot]; }
+  bool full() const { return size_ == capacity_; }
+  uint32_t size() const { return size_; }
+  uint32_t capacity() const { return capacity_; }
+
+private:
+  typedef typename std::aligned_storage<sizeof(T), alignof(T)>::type Storage;
+
+  std::unique_ptr<Storage[]> storage_;
+  std::vector<bool> live_;
+  const uint32_t capacity_;
+  uint32_t size_;
+  uint32_t cursor_;
+};
+
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+#include <stdexcept>
+
+namespace utils {
+
+/* 64-bit ids, unique across the engine without coordination:
+ *
+ * | symbol_id (20) | shard (8) | sequence (36) |
+ *
+ * the sequence is per (symbol, shard) and strictly increasing,
+ * so ids from one book are ordered. fields that don't fit, including a
+ * sequence past 2^36 - 1, are rejected rather than truncated into the
+ * id of another symbol or an earlier one */
+
+constexpr uint32_t SEQ_ID_SEQUENCE_BITS = 36;
+constexpr uint32_t SEQ_ID_SHARD_BITS = 8;
+constexpr uint32_t SEQ_ID_SYMBOL_BITS = 20;
+
+constexpr uint64_t SEQ_ID_SEQUENCE_MASK = (1ull << SEQ_ID_SEQUENCE_BITS) - 1;
+constexpr uint64_t SEQ_ID_SHARD_MASK = (1ull << SEQ_ID_SHARD_BITS) - 1;
+constexpr uint64_t SEQ_ID_SYMBOL_MASK = (1ull << SEQ_ID_SYMBOL_BITS) - 1;
+
+/* symbol,shard,sequence->id */
+inline uint64_t make_seq_id(uint32_t symbol_id, uint32_t shard, uint64_t sequence) {
+  if(symbol_id > SEQ_ID_SYMBOL_MASK)
+    throw std::out_of_range("Symbol id exceeds the sequence id's 20 bits");
+
+  if(shard > SEQ_ID_SHARD_MASK)
+    throw std::out_of_range("Shard exceeds the sequence id's 8 bits");
+
+  if(sequence > SEQ_ID_SEQUENCE_MASK)
+    throw std::overflow_error("Sequence exceeds the sequence id's 36 bits");
+
+  return ((uint64_t)symbol_id << (SEQ_ID_SHARD_BITS + SEQ_ID_SEQUENCE_BITS))
+    | ((uint64_t)shard << SEQ_ID_SEQUENCE_BITS)
+    | sequence;
+}
+
+/* id->symbol */
+inline uint32_t seq_id_symbol(uint64_t id) {
+  return (uint32_t)(id >> (SEQ_ID_SHARD_BITS + SEQ_ID_SEQUENCE_BITS));
+}
+
+/* id->shard */
+inline uint32_t seq_id_shard(uint64_t id) {
+  return (uint32_t)((id >> SEQ_ID_SEQUENCE_BITS) & SEQ_ID_SHARD_MASK);
+}
+
+/* id->sequence */
+inline uint64_t seq_id_sequence(uint64_t id) {
+  return id & SEQ_ID_SEQUENCE_MASK;
+}
+
+}
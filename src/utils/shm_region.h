@@ -0,0 +1,70 @@
+#pragma once
+
+#include <string>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace utils {
+
+/* a named POSIX shared-memory mapping. the process that creates it
+ * unlinks it when done; others map it, read-only or not, with the size
+ * it was created with */
+
+class ShmRegion {
+public:
+  ShmRegion(const std::string& name, size_t size, bool writable, bool create) :
+    name_(name), size_(size), base_(nullptr), owner_(create)
+  {
+    int fd = shm_open(name.c_str(),
+      create ? O_CREAT | O_TRUNC | O_RDWR : (writable ? O_RDWR : O_RDONLY), 0644);
+
+    if(fd < 0)
+      throw std::runtime_error("shm_open failed for " + name);
+
+    if(create && ftruncate(fd, size) != 0) {
+      close(fd);
+      throw std::runtime_error("ftruncate failed for " + name);
+    }
+
+    if(!create) {
+      struct stat st;
+      if(fstat(fd, &st) != 0) {
+        close(fd);
+        throw std::runtime_error("fstat failed for " + name);
+      }
+      size_ = st.st_size;
+    }
+
+    void* base = mmap(nullptr, size_,
+      writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if(base == MAP_FAILED)
+      throw std::runtime_error("mmap failed for " + name);
+
+    base_ = static_cast<char*>(base);
+  }
+
+  ~ShmRegion() {
+    munmap(base_, size_);
+    if(owner_) shm_unlink(name_.c_str());
+  }
+
+  ShmRegion(const ShmRegion&) = delete;
+  ShmRegion& operator=(const ShmRegion&) = delete;
+
+  char* base() const { return base_; }
+  size_t size() const { return size_; }
+
+private:
+  std::string name_;
+  size_t size_;
+  char* base_;
+  bool owner_; /* created it, unlinks it */
+};
+
+}
@@ -0,0 +1,211 @@
+#pragma once
+
+#include <atomic>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include "shm_region.h"
+
+namespace utils {
+
+/* single-writer, multi-reader broadcast ring of variable-length frames in
+ * POSIX shared memory.
+ *
+ * the writer encodes a frame in place (reserve(), then commit()) and
+ * publishes it by advancing write_pos with a release store: no syscall,
+ * no copy. readers map the region read-only and follow write_pos at their
+ * own pace. the writer never waits for readers. a reader falling more
+ * than the capacity behind has lost frames, which poll() reports.
+ *
+ * before overwriting any byte, the writer advances reserve_pos past the
+ * frame it is about to write. a reader copies a frame out, then checks
+ * that reserve_pos is still less than a capacity ahead of the frame,
+ * as a seqlock reader checks its sequence: a frame is only handed over
+ * if the writer could not have been overwriting it during the copy.
+ *
+ * frames are 8-byte aligned: an 8-byte frame header (payload length and
+ * kind) followed by the payload. a frame that would straddle the end of
+ * the ring is preceded by a padding frame up to the end. */
+
+struct ShmRingHeader {
+  enum : uint64_t { MAGIC = 0x474e4952534b4245ull }; /* "EBKSRING" */
+  enum : uint32_t { VERSION = 2 };
+
+  uint64_t magic;
+  uint32_t version;
+  uint32_t reserved;
+  uint64_t capacity; /* bytes of frames, a power of two */
+  alignas(64) std::atomic<uint64_t> write_pos; /* bytes written, ever */
+  std::atomic<uint64_t> reserve_pos; /* end of the frame being written */
+  char padding[48];
+};
+
+static_assert(sizeof(ShmRingHeader) == 128, "ring header spans two cache lines");
+
+struct ShmFrameHeader {
+  enum : uint32_t { data = 0, pad = 1 };
+
+  uint32_t length; /* payload bytes */
+  uint32_t kind;
+};
+
+inline size_t shm_frame_size(size_t length) {
+  return sizeof(ShmFrameHeader) + ((length + 7) & ~(size_t)7);
+}
+
+class ShmRingWriter {
+public:
+  /* creates (or truncates) the region. `capacity` is rounded up to a
+     power of two */
+  ShmRingWriter(const std::string& name, size_t capacity) :
+    region_(name, sizeof(ShmRingHeader) + round_up(capacity), true, true),
+    header_(reinterpret_cast<ShmRingHeader*>(region_.base())),
+    frames_(region_.base() + sizeof(ShmRingHeader)),
+    capacity_(round_up(capacity)),
+    pos_(0)
+  {
+    header_->capacity = capacity_;
+    header_->reserved = 0;
+    header_->version = ShmRingHeader::VERSION;
+    header_->write_pos.store(0, std::memory_order_relaxed);
+    header_->reserve_pos.store(0, std::memory_order_relaxed);
+
+    /* readers check the magic last */
+    std::atomic_thread_fence(std::memory_order_release);
+    header_->magic = ShmRingHeader::MAGIC;
+  }
+
+  /* returns where to write up to `length` payload bytes, contiguous */
+  char* reserve(size_t length) {
+    const size_t frame = shm_frame_size(length);
+    if(frame > capacity_)
+      throw std::runtime_error("Frame exceeds ring capacity");
+
+    size_t offset = pos_ & (capacity_ - 1);
+    const bool wraps = offset + frame > capacity_;
+
+    /* readers of the bytes about to be overwritten see them as lost */
+    header_->reserve_pos.store(
+      pos_ + (wraps ? capacity_ - offset : 0) + frame, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    if(wraps) {
+      ShmFrameHeader* pad = reinterpret_cast<ShmFrameHeader*>(frames_ + offset);
+      pad->length = (uint32_t)(capacity_ - offset - sizeof(ShmFrameHeader));
+      pad->kind = ShmFrameHeader::pad;
+      pos_ += capacity_ - offset;
+      offset = 0;
+    }
+
+    return frames_ + offset + sizeof(ShmFrameHeader);
+  }
+
+  /* publishes the `length` bytes written since reserve() */
+  void commit(size_t length) {
+    ShmFrameHeader* frame = reinterpret_cast<ShmFrameHeader*>(
+      frames_ + (pos_ & (capacity_ - 1)));
+
+    frame->length = (uint32_t)length;
+    frame->kind = ShmFrameHeader::data;
+
+    pos_ += shm_frame_size(length);
+    header_->write_pos.store(pos_, std::memory_order_release);
+  }
+
+  size_t capacity() const { return capacity_; }
+  uint64_t write_pos() const { return pos_; }
+
+private:
+  ShmRegion region_;
+  ShmRingHeader* header_;
+  char* frames_;
+  const size_t capacity_;
+  uint64_t pos_;
+
+  static size_t round_up(size_t n) {
+    size_t capacity = 64;
+    while(capacity < n) capacity <<= 1;
+    return capacity;
+  }
+};
+
+
+class ShmRingReader {
+public:
+  /* maps an existing ring read-only, and starts at its current end */
+  ShmRingReader(const std::string& name) :
+    region_(name, 0, false, false),
+    header_(reinterpret_cast<const ShmRingHeader*>(region_.base())),
+    frames_(region_.base() + sizeof(ShmRingHeader)),
+    lost_(0)
+  {
+    if(region_.size() < sizeof(ShmRingHeader) ||
+      header_->magic != ShmRingHeader::MAGIC ||
+      header_->version != ShmRingHeader::VERSION)
+      throw std::runtime_error("Not a ring, or an unsupported version");
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    capacity_ = header_->capacity;
+    pos_ = header_->write_pos.load(std::memory_order_acquire);
+    frame_.resize(capacity_);
+  }
+
+  /* calls `on_frame(const char* data, size_t length)` for every frame
+     published since the last call, with a copy of the frame valid until
+     the next call. frames the writer overwrote before they could be
+     copied are skipped, as lost. returns the number of frames read */
+  template <class OnFrame>
+  size_t poll(OnFrame on_frame) {
+    size_t read = 0;
+    const uint64_t end = header_->write_pos.load(std::memory_order_acquire);
+
+    while(pos_ < end) {
+      const size_t offset = pos_ & (capacity_ - 1);
+      ShmFrameHeader frame;
+      memcpy(&frame, frames_ + offset, sizeof(frame));
+
+      /* a length read from an overwritten frame may be anything */
+      size_t length = std::min<size_t>(frame.length,
+        capacity_ - offset - sizeof(ShmFrameHeader));
+
+      if(frame.kind == ShmFrameHeader::data)
+        memcpy(frame_.data(), frames_ + offset + sizeof(ShmFrameHeader), length);
+
+      std::atomic_thread_fence(std::memory_order_acquire);
+
+      /* the writer lapped us, before or while copying */
+      if(header_->reserve_pos.load(std::memory_order_relaxed) - pos_ > capacity_) {
+        ++lost_;
+        pos_ = header_->write_pos.load(std::memory_order_acquire);
+        break;
+      }
+
+      if(frame.kind == ShmFrameHeader::data) {
+        on_frame((const char*)frame_.data(), length);
+        ++read;
+      }
+
+      pos_ += shm_frame_size(length);
+    }
+
+    return read;
+  }
+
+  /* times the reader fell behind by more than the capacity */
+  uint64_t lost() const { return lost_; }
+
+private:
+  ShmRegion region_;
+  const ShmRingHeader* header_;
+  const char* frames_;
+  uint64_t capacity_;
+  uint64_t pos_;
+  uint64_t lost_;
+  std::vector<char> frame_; /* the frame handed to on_frame */
+};
+
+}
@@ -0,0 +1,167 @@
+#pragma once
+
+#include <mutex>
+#include <deque>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <memory>
+#include <exception>
+#include <functional>
+#include <condition_variable>
+
+namespace utils {
+
+/* work-stealing thread pool for coarse, independent tasks.
+ *
+ * every worker owns a deque. submitted tasks are dealt round-robin;
+ * a worker runs its own tasks oldest first, and once out of work steals
+ * the oldest task of another worker, so tasks start in about the order
+ * they were submitted. tasks are expected to run for milliseconds or
+ * more, so deques are guarded by a plain mutex.
+ *
+ * a task that throws doesn't stop its worker: the first exception is
+ * rethrown by wait(), once every task has run. */
+
+class ThreadPool {
+public:
+  typedef std::function<void()> Task;
+
+  ThreadPool(size_t threads = std::thread::hardware_concurrency()) :
+    queues_(threads ? threads : 1),
+    next_(0),
+    pending_(0),
+    stop_(false)
+  {
+    for(size_t i = 0; i < queues_.size(); ++i)
+      queues_[i].reset(new Queue());
+
+    for(size_t i = 0; i < queues_.size(); ++i)
+      workers_.emplace_back([this, i]() { run(i); });
+  }
+
+  ~ThreadPool() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+
+    wake_.notify_all();
+    for(auto& worker : workers_) worker.join();
+  }
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  void submit(Task task) {
+    Queue& queue = *queues_[next_++ % queues_.size()];
+
+    {
+      /* pushed under mutex_, so that a worker can't miss it between
+         finding no task and going to sleep */
+      std::lock_guard<std::mutex> lock(mutex_);
+      ++pending_;
+
+      std::lock_guard<std::mutex> queue_lock(queue.mutex);
+      queue.tasks.push_back(std::move(task));
+    }
+
+    wake_.notify_one();
+  }
+
+  /* blocks until every submitted task has run, then rethrows the first
+     exception thrown by a task since the last wait() */
+  void wait() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_.wait(lock, [this]() { return pending_ == 0; });
+
+    if(error_) {
+      std::exception_ptr error = error_;
+      error_ = nullptr;
+      std::rethrow_exception(error);
+    }
+  }
+
+  size_t size() const { return workers_.size(); }
+
+private:
+  struct Queue {
+    std::mutex mutex;
+    std::deque<Task> tasks;
+  };
+
+  std::vector<std::unique_ptr<Queue>> queues_;
+  std::vector<std::thread> workers_;
+  size_t next_;
+
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  std::condition_variable done_;
+  size_t pending_; /* submitted and not yet run, guarded by mutex_ */
+  std::exception_ptr error_; /* guarded by mutex_ */
+  bool stop_;
+
+  bool pop(size_t self, Task& task) {
+    {
+      Queue& own = *queues_[self];
+      std::lock_guard<std::mutex> lock(own.mutex);
+      if(!own.tasks.empty()) {
+        task = std::move(own.tasks.front());
+        own.tasks.pop_front();
+        return true;
+      }
+    }
+
+    for(size_t i = 1; i < queues_.size(); ++i) {
+      Queue& victim = *queues_[(self + i) % queues_.size()];
+      std::lock_guard<std::mutex> lock(victim.mutex);
+      if(!victim.tasks.empty()) {
+        task = std::move(victim.tasks.front());
+        victim.tasks.pop_front();
+        return true;
+      }
+    }
+
+    return false;
+  }
+
+  void run(size_t self) {
+    Task task;
+
+    for(;;) {
+      if(pop(self, task)) {
+        std::exception_ptr error;
+
+        try {
+          task();
+        } catch(...) {
+          error = std::current_exception();
+        }
+
+        task = nullptr;
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        if(error && !error_) error_ = error;
+        if(--pending_ == 0) done_.notify_all();
+        continue;
+      }
+
+      /* tasks left are run before stopping */
+      std::unique_lock<std::mutex> lock(mutex_);
+      wake_.wait(lock, [this]() { return stop_ || queued() > 0; });
+      if(stop_ && queued() == 0) return;
+    }
+  }
+
+  /* tasks pushed but not popped yet. called with mutex_ held */
+  size_t queued() {
+    size_t queued = 0;
+    for(auto& queue : queues_) {
+      std::lock_guard<std::mutex> lock(queue->mutex);
+      queued += queue->tasks.size();
+    }
+    return queued;
+  }
+};
+
+}
@@ -0,0 +1,264 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cassert>
+#include <vector>
+#include <algorithm>
+
+namespace utils {
+
+/* hierarchical timing wheel. time is counted in ticks of `tick_ns`.
+ *
+ * level 0 has one slot per tick for the next 256 ticks, level 1 one slot
+ * per 256 ticks, and so on up to 2^32 ticks. later timers wait in an
+ * overflow list. a timer is placed at the level of the highest byte in
+ * which its tick differs from the current tick, and moved down a level
+ * (cascaded) when the wheel reaches the start of its slot.
+ *
+ * timers are nodes of intrusive lists: scheduling and cancelling are
+ * O(1) and don't allocate once the node storage has grown. advancing
+ * jumps straight to the next occupied slot of the lowest occupied level,
+ * or to the block of the earliest overflow timer: its cost depends on
+ * the timers due or cascaded, not on the time elapsed. */
+
+/* handle of a scheduled timer */
+typedef uint32_t TimerId;
+const TimerId NULL_TIMER = UINT32_MAX;
+
+template <class T>
+class TimingWheel {
+public:
+  enum : uint32_t { npos = NULL_TIMER };
+
+  TimingWheel(uint64_t tick_ns, uint64_t start_ns = 0) :
+    tick_ns_(tick_ns),
+    now_tick_(start_ns / tick_ns),
+    heads_(LEVELS * SLOTS + 1, npos),
+    level_size_(),
+    size_(0) { }
+
+  /* moves the wheel, empty, to `now_ns`. timers scheduled far from the
+     wheel's time wait in the overflow list, and are cascaded down when
+     it gets there: a wheel whose clock doesn't start at 0 is seeded
+     with the time before timers are scheduled */
+  void seed(uint64_t now_ns) {
+    assert(size_ == 0);
+    now_tick_ = now_ns / tick_ns_;
+  }
+
+  /* returns a handle for cancel(). timers already due fire on the
+     next advance() */
+  TimerId schedule(uint64_t expiry_ns, const T& value) {
+    uint32_t node;
+
+    if(!free_nodes_.empty()) {
+      node = free_nodes_.back();
+      free_nodes_.pop_back();
+    } else {
+      node = (uint32_t)nodes_.size();
+      nodes_.emplace_back();
+    }
+
+    Node& n = nodes_[node];
+    n.value = value;
+    n.tick = expiry_ns / tick_ns_;
+    if(n.tick < now_tick_) n.tick = now_tick_;
+
+    link(node);
+    ++size_;
+    return node;
+  }
+
+  void cancel(TimerId handle) {
+    unlink(handle);
+    free_nodes_.push_back(handle);
+    --size_;
+  }
+
+  /* fires every timer due at `now_ns`, earliest tick first, calling
+     `on_expire(value)`. a timer is cancelled before its callback runs,
+     and callbacks may schedule or cancel other timers. stops after
+     `limit` timers, the rest fire on the next call.
+     returns the number of timers fired */
+  template <class OnExpire>
+  size_t advance(uint64_t now_ns, OnExpire on_expire, size_t limit = SIZE_MAX) {
+    const uint64_t target = now_ns / tick_ns_;
+    size_t fired = 0;
+
+    while(now_tick_ <= target) {
+      if(size_ == 0) {
+        now_tick_ = target + 1;
+        break;
+      }
+
+      /* nothing can be due before the next occupied slot of the lowest
+         occupied level: due there at level 0, cascaded down otherwise */
+      uint32_t level = 0;
+      while(level < LEVELS && level_size_[level] == 0) ++level;
+
+      const uint64_t next = next_slot(level);
+
+      if(next > target) {
+        now_tick_ = target + 1;
+
+        /* landing at the start of the slot, it's cascaded now */
+        if(level > 0 && now_tick_ == next)
+          cascade();
+        break;
+      }
+
+      now_tick_ = next;
+
+      if(level > 0) {
+        cascade();
+        continue;
+      }
+
+      uint32_t& head = heads_[now_tick_ & MASK];
+      while(head != npos) {
+        if(fired == limit) return fired;
+
+        uint32_t node = head;
+        T value = nodes_[node].value;
+        cancel(node);
+
+        on_expire(value);
+        ++fired;
+      }
+
+      if((++now_tick_ & MASK) == 0)
+        cascade();
+    }
+
+    return fired;
+  }
+
+  /* drops every timer */
+  void clear() {
+    nodes_.clear();
+    free_nodes_.clear();
+    std::fill(heads_.begin(), heads_.end(), (uint32_t)npos);
+    std::fill(level_size_, level_size_ + LEVELS + 1, 0);
+    size_ = 0;
+  }
+
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+  uint64_t tick_ns() const { return tick_ns_; }
+
+private:
+  enum : uint32_t {
+    BITS = 8,
+    SLOTS = 1 << BITS,
+    MASK = SLOTS - 1,
+    LEVELS = 4,
+    OVERFLOW = LEVELS * SLOTS
+  };
+
+  struct Node {
+    T value;
+    uint64_t tick;
+    uint32_t prev;
+    uint32_t next;
+    uint32_t slot;
+  };
+
+  const uint64_t tick_ns_;
+  uint64_t now_tick_; /* every tick before it has fired */
+
+  std::vector<Node> nodes_;
+  std::vector<uint32_t> free_nodes_;
+  std::vector<uint32_t> heads_;   /* level * SLOTS + slot, then overflow */
+  size_t level_size_[LEVELS + 1]; /* timers per level, then overflow */
+  size_t size_;
+
+  void link(uint32_t node) {
+    Node& n = nodes_[node];
+
+    const uint64_t diff = n.tick ^ now_tick_;
+    uint32_t level = 0;
+    while(level < LEVELS && (diff >> ((level + 1) * BITS)) != 0) ++level;
+
+    n.slot = level == LEVELS ? (uint32_t)OVERFLOW :
+      level * SLOTS + ((n.tick >> (level * BITS)) & MASK);
+
+    uint32_t& head = heads_[n.slot];
+    n.prev = npos;
+    n.next = head;
+
+    if(head != npos)
+      nodes_[head].prev = node;
+
+    head = node;
+    ++level_size_[level];
+  }
+
+  void unlink(uint32_t node) {
+    Node& n = nodes_[node];
+
+    if(n.next != npos)
+      nodes_[n.next].prev = n.prev;
+
+    if(n.prev != npos)
+      nodes_[n.prev].next = n.next;
+    else
+      heads_[n.slot] = n.next;
+
+    --level_size_[n.slot == OVERFLOW ? LEVELS : n.slot / SLOTS];
+  }
+
+  /* the first tick of the next occupied slot of `level`, which has
+     timers. a level above 0 has none in the current slot, already
+     cascaded. overflow timers are cascaded from the start of the block
+     of the earliest */
+  uint64_t next_slot(uint32_t level) const {
+    if(level == LEVELS) {
+      uint64_t earliest = UINT64_MAX;
+      for(uint32_t node = heads_[OVERFLOW]; node != npos; node = nodes_[node].next)
+        earliest = std::min(earliest, nodes_[node].tick);
+
+      return earliest & ~((1ull << (LEVELS * BITS)) - 1);
+    }
+
+    const uint32_t shift = level * BITS;
+    const uint64_t block = now_tick_ & ~((1ull << (shift + BITS)) - 1);
+    uint32_t slot = (uint32_t)((now_tick_ >> shift) & MASK) + (level > 0);
+
+    while(heads_[level * SLOTS + slot] == npos) {
+      ++slot;
+      assert(slot < SLOTS);
+    }
+
+    return block + ((uint64_t)slot << shift);
+  }
+
+  /* moves the timers of the slots starting at now_tick_ down, higher
+     levels first so that they land in slots not cascaded yet */
+  void cascade() {
+    uint32_t rolled = 1;
+    while(rolled < LEVELS &&
+      (now_tick_ & ((1ull << ((rolled + 1) * BITS)) - 1)) == 0) ++rolled;
+
+    if(rolled == LEVELS)
+      relink(OVERFLOW);
+
+    for(uint32_t level = rolled < LEVELS ? rolled : LEVELS - 1; level >= 1; --level)
+      relink(level * SLOTS + ((now_tick_ >> (level * BITS)) & MASK));
+  }
+
+  void relink(uint32_t slot) {
+    uint32_t node = heads_[slot];
+    heads_[slot] = npos;
+
+    while(node != npos) {
+      uint32_t next = nodes_[node].next;
+      --level_size_[slot == OVERFLOW ? LEVELS : slot / SLOTS];
+      link(node);
+      node = next;
+    }
+  }
+};
+
+}
@@ -1,12 +1,119 @@
 #include "ts.h"
 
+#include <time.h>
+#include <mutex>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
+
 namespace utils {
 
 
+TscClock tsc_clock;
+
+static std::mutex calibrate_mutex;
+static std::once_flag init_flag;
+
+std::atomic<uint64_t> wall_anchor_ts(0);
+std::atomic<uint64_t> wall_base_ns(0);
+
+/* the TSC is only usable as a clock if its rate does not
+   change with frequency scaling and sleep states */
+static bool has_invariant_tsc() {
+#if defined(__x86_64__) || defined(__i386__)
+  unsigned int eax, ebx, ecx, edx;
+  if(!__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx)) return false;
+  return edx & (1 << 8);
+#else
+  return false;
+#endif
+}
+
+static void publish(const TscCalibration& c) {
+  const uint32_t seq = tsc_clock.seq.load(std::memory_order_relaxed);
+
+  tsc_clock.seq.store(seq + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  tsc_clock.base_ticks.store(c.base_ticks, std::memory_order_relaxed);
+  tsc_clock.base_ns.store(c.base_ns, std::memory_order_relaxed);
+  tsc_clock.mult.store(c.mult, std::memory_order_relaxed);
+  tsc_clock.use_tsc.store(c.use_tsc, std::memory_order_relaxed);
+
+  tsc_clock.seq.store(seq + 2, std::memory_order_release);
+}
+
+void calibrate(uint64_t duration_us) {
+  std::lock_guard<std::mutex> lock(calibrate_mutex);
+
+  /* carries on from the clock's value, if calibrated */
+  const bool calibrated = tsc_clock.seq.load(std::memory_order_acquire) != 0;
+
+  TscCalibration c;
+  c.use_tsc = has_invariant_tsc();
+
+#if defined(__x86_64__) || defined(__i386__)
+  if(c.use_tsc) {
+    uint64_t t0 = __rdtsc();
+    uint64_t s0 = steady_ns();
+    uint64_t s1;
+
+    do { s1 = steady_ns(); } while(s1 - s0 < duration_us * 1000);
+    uint64_t t1 = __rdtsc();
+
+    if(t1 > t0) {
+      c.mult = ((s1 - s0) << 32) / (t1 - t0);
+      c.base_ticks = t1;
+      c.base_ns = calibrated ? ts_ns() : 0;
+    }
+    else
+      c.use_tsc = false;
+  }
+#endif
+
+  if(!c.use_tsc) {
+    c.mult = 1ull << 32;
+    c.base_ns = calibrated ? ts_ns() : 0;
+    c.base_ticks = steady_ns();
+  }
+
+  /* anchored before publishing, for readers converting right after */
+  wall_base_ns.store(wall_ns() - c.base_ns, std::memory_order_relaxed);
+  wall_anchor_ts.store(c.base_ns, std::memory_order_relaxed);
+
+  publish(c);
+}
+
+void init_clock() {
+  std::call_once(init_flag, []() {
+    if(tsc_clock.seq.load(std::memory_order_acquire) == 0) calibrate();
+  });
+}
+
+/* threads converting at once may each read the clock, the last store
+   wins */
+void anchor_wall() {
+  const uint64_t now = ts_ns();
+  wall_base_ns.store(wall_ns() - now, std::memory_order_relaxed);
+  wall_anchor_ts.store(now, std::memory_order_relaxed);
+}
+
+
+uint64_t ts_coarse_ns() {
+#if defined(CLOCK_MONOTONIC_COARSE)
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC_COARSE, &t);
+  return (uint64_t)t.tv_sec * 1000000000 + t.tv_nsec;
+#else
+  return steady_ns();
+#endif
+}
+
+
 uint64_t ts() {
-  return std::chrono::duration_cast<std::chrono::microseconds>(
-      std::chrono::system_clock::now().time_since_epoch()).count();
+  return wall_ns() / 1000;
 }
 
 
-}
\ No newline at end of file
+}
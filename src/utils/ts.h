@@ -1,7 +1,138 @@
+/*
+  Timestamps.
+
+  - ts_ns(): monotonic nanoseconds, read from the TSC and scaled with a
+    multiplier calibrated against the steady clock. a read is a few
+    nanoseconds, cheap enough to stamp every callback. falls back to the
+    steady clock when the TSC is not invariant or not available
+  - ts_coarse_ns(): monotonic nanoseconds at scheduler tick resolution
+    (a few ms), for timeouts and housekeeping
+  - to_wall_ns(): converts a ts_ns() timestamp to nanoseconds since epoch
+  - wall_ns(), ts(): the system clock, in nanoseconds and microseconds
+    since epoch
+
+  ts_ns() is calibrated on first use, which busy-waits about 10ms:
+  processes that mind call init_clock() at startup. It counts from there.
+  Long running processes may call calibrate() again, from any thread, to
+  correct the drift of the TSC against the steady clock; ts_ns() carries
+  on from its current value. The calibration is published under a
+  seqlock, readers retrying while it's rewritten. ts_coarse_ns() has its
+  own, unrelated origin.
+
+  The TSC drifts from the system clock, which NTP also adjusts, so
+  to_wall_ns() re-reads the system clock once ts_ns() has moved on by
+  WALL_ANCHOR_NS since its last read. A conversion is off by the drift
+  over that period at most, and may step by as much when re-anchored.
+*/
+
+#pragma once
+
 #include <chrono>
+#include <atomic>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
 
 namespace utils {
 
+struct TscCalibration {
+  uint64_t base_ticks;
+  uint64_t base_ns;      /* ts_ns() at base_ticks */
+  uint64_t mult;         /* ns per tick, 32.32 fixed point */
+  bool use_tsc;
+};
+
+/* the published calibration. `seq` is odd while calibrate() writes the
+   fields, and 0 until the first calibration. zero-initialized, so that
+   it's usable from static initializers */
+struct TscClock {
+  std::atomic<uint32_t> seq;
+  std::atomic<uint64_t> base_ticks;
+  std::atomic<uint64_t> base_ns;
+  std::atomic<uint64_t> mult;
+  std::atomic<bool> use_tsc;
+};
+
+extern TscClock tsc_clock;
+
+const uint64_t WALL_ANCHOR_NS = 1000000000;
+
+/* ts_ns() of the last read of the system clock, and the wall time at
+   ts_ns() == 0 then */
+extern std::atomic<uint64_t> wall_anchor_ts;
+extern std::atomic<uint64_t> wall_base_ns;
+
+/* measures the TSC rate over `duration_us`, and publishes it */
+void calibrate(uint64_t duration_us = 10000);
+
+/* calibrates once, unless done already. called by the first read */
+void init_clock();
+
+inline TscCalibration calibration() {
+  for(;;) {
+    const uint32_t seq = tsc_clock.seq.load(std::memory_order_acquire);
+
+    if(seq == 0) {
+      init_clock();
+      continue;
+    }
+
+    if(seq & 1) continue;
+
+    TscCalibration c;
+    c.base_ticks = tsc_clock.base_ticks.load(std::memory_order_relaxed);
+    c.base_ns = tsc_clock.base_ns.load(std::memory_order_relaxed);
+    c.mult = tsc_clock.mult.load(std::memory_order_relaxed);
+    c.use_tsc = tsc_clock.use_tsc.load(std::memory_order_relaxed);
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if(tsc_clock.seq.load(std::memory_order_relaxed) == seq)
+      return c;
+  }
+}
+
+inline uint64_t steady_ns() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+inline uint64_t read_ticks(const TscCalibration& c) {
+#if defined(__x86_64__) || defined(__i386__)
+  if(c.use_tsc)
+    return __rdtsc();
+#endif
+  return steady_ns();
+}
+
+inline uint64_t ticks_to_ns(const TscCalibration& c, uint64_t ticks) {
+  /* (ticks * mult) >> 32, without overflowing 64 bits */
+  return (ticks >> 32) * c.mult + (((ticks & 0xffffffff) * c.mult) >> 32);
+}
+
+inline uint64_t ts_ns() {
+  const TscCalibration c = calibration();
+  return c.base_ns + ticks_to_ns(c, read_ticks(c) - c.base_ticks);
+}
+
+inline uint64_t wall_ns() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+/* reads the system clock against ts_ns() */
+void anchor_wall();
+
+inline uint64_t to_wall_ns(uint64_t ts) {
+  if((int64_t)(ts - wall_anchor_ts.load(std::memory_order_relaxed)) > (int64_t)WALL_ANCHOR_NS)
+    anchor_wall();
+
+  return wall_base_ns.load(std::memory_order_relaxed) + ts;
+}
+
+uint64_t ts_coarse_ns();
+
 uint64_t ts();
 
 
@@ -1,5 +1,7 @@
 #include "uint128.h"
 
+#include <stdexcept>
+
 namespace utils {
 
 
@@ -16,6 +18,8 @@ uint128 operator<<(const uint64_t & lhs, const uint128 & rhs){
 
 
 
+#ifndef UTILS_NATIVE_INT128
+
 uint128 & uint128::operator+=(const uint128 & rhs){
     hi += rhs.hi + ((lo + rhs.lo) < lo);
     lo += rhs.lo;
@@ -104,7 +108,15 @@ uint128 uint128::operator>>(const uint32_t & rhs) const{
 }
 
 
+#endif
+
+
 uint8_t uint128::bits() const{
+#if defined(__GNUC__)
+    if (hi) return (uint8_t)(128 - __builtin_clzll(hi));
+    if (lo) return (uint8_t)(64 - __builtin_clzll(lo));
+    return 0;
+#else
     uint8_t out = 0;
     if (hi){
         out = 64;
@@ -122,6 +134,7 @@ uint8_t uint128::bits() const{
         }
     }
     return out;
+#endif
 }
 
 
@@ -139,6 +152,11 @@ std::pair <uint128, uint128> uint128::divmod(const uint128 & lhs, const uint128
     return std::pair <uint128, uint128> (uint128_0, lhs);
   }
 
+#ifdef UTILS_NATIVE_INT128
+  return std::pair <uint128, uint128> (
+    from_native(lhs.native() / rhs.native()),
+    from_native(lhs.native() % rhs.native()));
+#else
   std::pair <uint128, uint128> qr (uint128_0, uint128_0);
   for(uint8_t x = lhs.bits(); x > 0; x--){
     qr.first  <<= uint128_1;
@@ -154,40 +172,46 @@ std::pair <uint128, uint128> uint128::divmod(const uint128 & lhs, const uint128
     }
   }
   return qr;
+#endif
 }
 
 
-uint128 uint128::operator&(const uint128 & rhs) const{
-  return uint128(hi & rhs.hi, lo & rhs.lo);
-}
-
-uint128 uint128::operator&(const uint32_t & rhs) const{
-  return uint128(0, lo & rhs);
-}
-
+/* digits are produced from the end of a fixed buffer: 128 bits are at
+   most 128 digits (base 2). values fitting 64 bits are divided natively */
 std::string uint128::to_string(uint8_t base, const unsigned int & len) const {
   if ((base < 2) || (base > 16)){
     throw std::invalid_argument("Base must be in the range [2, 16]");
   }
-  std::string out = "";
-  if (!(*this)){
-      out = "0";
+
+  if (base == 16){
+    char out[uuid_len];
+    return std::string(out, to_uuid(out));
   }
-  else{
-      std::pair <uint128, uint128> qr(*this, uint128_0);
-      int i = 0;
-      do{
-          qr = divmod(qr.first, uint128(0, base));
-          out = "0123456789abcdef"[(uint8_t) qr.second] + out;
-
-          ++i;
-          if(i == 12 || i == 16 || i == 20 || i == 24) out = "-" + out; 
-      } while (qr.first);
+
+  static const char digits[] = "0123456789abcdef";
+  char out[128];
+  char* begin = out + sizeof(out);
+
+  uint128 value = *this;
+  const uint128 divisor(0, base);
+
+  while (value.hi){
+    std::pair <uint128, uint128> qr = divmod(value, divisor);
+    *--begin = digits[qr.second.lo];
+    value = qr.first;
   }
-  if (out.size() < len){
-      out = std::string(len - out.size(), '0') + out;
+
+  uint64_t low = value.lo;
+  do{
+    *--begin = digits[low % base];
+    low /= base;
+  } while (low);
+
+  std::string result(begin, out + sizeof(out));
+  if (result.size() < len){
+    result.insert(0, len - result.size(), '0');
   }
-  return out;
+  return result;
 }
 
 
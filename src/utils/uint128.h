@@ -1,7 +1,20 @@
 #pragma once
 
 #include <cstdint>
+#include <cstddef>
+#include <string>
 #include <iostream>
+#include <functional>
+
+/*
+  When the compiler has a native 128-bit integer, arithmetic, shifts and
+  division are done on it (a handful of instructions, or a libgcc call
+  for division). Otherwise, uint128.cpp falls back to the portable
+  two-word implementations.
+*/
+#if defined(__SIZEOF_INT128__) && !defined(UTILS_NO_NATIVE_INT128)
+#define UTILS_NATIVE_INT128 1
+#endif
 
 namespace utils {
 
@@ -10,13 +23,34 @@ typedef struct uint128 {
   uint64_t hi;
   uint64_t lo;
 
+  /* fixed output widths of to_hex() and to_uuid() */
+  enum : size_t { hex_len = 32, uuid_len = 36 };
+
   uint128() : hi(0), lo(0) {}
   uint128(uint64_t hi_, uint64_t lo_) : hi(hi_), lo(lo_) {}
 
+#ifdef UTILS_NATIVE_INT128
+  typedef unsigned __int128 native_type;
+
+  static uint128 from_native(native_type value) {
+    return uint128((uint64_t)(value >> 64), (uint64_t)value);
+  }
+
+  native_type native() const {
+    return ((native_type)hi << 64) | lo;
+  }
+#endif
+
   std::pair <uint128, uint128> divmod(const uint128 & lhs, const uint128 & rhs) const;
 
+  /* base 16 formats as a UUID (8-4-4-4-12), other bases are zero-padded to len */
   std::string to_string(uint8_t base = 16, const unsigned int & len = 32) const;
 
+  /* write exactly hex_len / uuid_len chars into `out`, no terminating null.
+     return the end of the written chars */
+  char* to_hex(char* out) const;
+  char* to_uuid(char* out) const;
+
 
   bool operator==(const uint128& rhs) const {
     return ((hi == rhs.hi) && (lo == rhs.lo));
@@ -27,14 +61,11 @@ typedef struct uint128 {
   }
 
   bool operator<(const uint128 & rhs) const{
-      if (hi == rhs.hi){
-          return (lo < rhs.lo);
-      }
-      return (hi < rhs.hi);
+    return (hi < rhs.hi) | ((hi == rhs.hi) & (lo < rhs.lo));
   }
 
   bool operator>=(const uint128 & rhs) const{
-      return ((*this > rhs) | (*this == rhs));
+    return !(*this < rhs);
   }
 
 
@@ -75,10 +106,7 @@ typedef struct uint128 {
   }
 
   bool operator>(const uint128 & rhs) const{
-    if (hi == rhs.hi){
-        return (lo > rhs.lo);
-    }
-    return (hi > rhs.hi);
+    return rhs < *this;
   }
 
   uint8_t bits() const;
@@ -91,4 +119,94 @@ typedef struct uint128 {
 } uint128;
 
 
-}
\ No newline at end of file
+#ifdef UTILS_NATIVE_INT128
+
+inline uint128 & uint128::operator+=(const uint128 & rhs){
+  return *this = from_native(native() + rhs.native());
+}
+
+inline uint128 uint128::operator-(const uint128 & rhs) const{
+  return from_native(native() - rhs.native());
+}
+
+inline uint128& uint128::operator++(){
+  return *this = from_native(native() + 1);
+}
+
+inline uint128 uint128::operator<<(const uint128 & rhs) const{
+  if(rhs.hi || rhs.lo >= 128) return uint128();
+  return from_native(native() << rhs.lo);
+}
+
+inline uint128 & uint128::operator<<=(const uint128 & rhs){
+  return *this = *this << rhs;
+}
+
+inline uint128 uint128::operator>>(const uint128 & rhs) const{
+  if(rhs.hi || rhs.lo >= 128) return uint128();
+  return from_native(native() >> rhs.lo);
+}
+
+inline uint128 uint128::operator>>(const uint32_t & rhs) const{
+  if(rhs >= 128) return uint128();
+  return from_native(native() >> rhs);
+}
+
+#endif
+
+
+inline uint128 uint128::operator&(const uint128 & rhs) const{
+  return uint128(hi & rhs.hi, lo & rhs.lo);
+}
+
+inline uint128 uint128::operator&(const uint32_t & rhs) const{
+  return uint128(0, lo & rhs);
+}
+
+
+inline char* uint128::to_hex(char* out) const {
+  static const char digits[] = "0123456789abcdef";
+
+  for(int i = 0; i < 16; ++i) {
+    out[i] = digits[(hi >> (60 - 4 * i)) & 0xf];
+    out[16 + i] = digits[(lo >> (60 - 4 * i)) & 0xf];
+  }
+
+  return out + hex_len;
+}
+
+
+inline char* uint128::to_uuid(char* out) const {
+  char hex[hex_len];
+  to_hex(hex);
+
+  /* 8-4-4-4-12 */
+  const char* in = hex;
+  for(int group : { 8, 4, 4, 4, 12 }) {
+    if(in != hex) *out++ = '-';
+    for(int i = 0; i < group; ++i) *out++ = *in++;
+  }
+
+  return out;
+}
+
+
+struct uint128_hash {
+  size_t operator()(const uint128& value) const {
+    uint64_t x = value.hi ^ (value.lo * 0x9E3779B97F4A7C15ull);
+    x ^= x >> 32;
+    x *= 0xD6E8FEB86659FD93ull;
+    x ^= x >> 32;
+    return (size_t)x;
+  }
+};
+
+
+}
+
+namespace std {
+
+template <>
+struct hash<utils::uint128> : public utils::uint128_hash {};
+
+}
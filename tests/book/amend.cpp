@@ -0,0 +1,140 @@
+#include <doctest/doctest.h>
+#include <memory>
+
+#include <book/types.h>
+#include <book/plugins/mass_cancel.h>
+#include <depth/depth_book.h>
+#include "fixtures/order.h"
+#include "fixtures/me.h"
+
+#define SYMBOL_ID_1 1
+#define USER_1 1
+#define USER_2 2
+
+#define BUY true
+#define SELL false
+
+namespace amend_test {
+
+typedef fixtures::OrderWithUserID Order;
+typedef std::shared_ptr<Order> OrderPtr;
+
+typedef book::ComposeTracker<OrderPtr,
+  book::plugins::MassCancelTracker> Tracker;
+
+typedef fixtures::ME<
+  Tracker,
+  book::plugins::MassCancelPlugin<Tracker>
+> Book;
+
+typedef Book::TypedCallback Cb;
+
+class TestDepthBook : public depth::DepthBook<OrderPtr, 5> {
+public:
+  TestDepthBook() : depth::DepthBook<OrderPtr, 5>({ 1, 10, 100, 1000 }) {}
+
+  void add(double price, double qty, bool is_bid) {
+    depth_.add_order(price, qty, is_bid);
+  }
+
+  void on_depth_change() {}
+  void on_bbo_change() {}
+};
+
+
+TEST_CASE("amend") {
+  Book book(SYMBOL_ID_1);
+
+  auto order = std::make_shared<Order>(USER_1, BUY, 1000, 3, 0);
+  auto other = std::make_shared<Order>(USER_2, BUY, 999, 1, 0);
+  book.add(order);
+  book.add(other);
+
+  /* partially filled */
+  book.add(std::make_shared<Order>(USER_2, SELL, 1000, 1, 0));
+
+  SUBCASE("the order moves to the back of its new level") {
+    auto amended = std::make_shared<Order>(USER_1, BUY, 999, 4, 0);
+
+    book.start_recording_callbacks();
+    book.amend(order, amended);
+
+    Book::Callbacks cb = book.get_recorded_callbacks();
+    REQUIRE(cb.size() == 2);
+    CHECK(cb[0].type == Cb::cb_order_replace);
+    CHECK(cb[0].order == order);
+    CHECK(cb[0].price == 999);
+    CHECK(cb[0].generic_1 == 1);  /* open qty from 2 to 3 */
+    CHECK(cb[0].generic_2 == 2);
+    CHECK(cb[0].qty == 1);        /* fills are kept */
+    CHECK(cb[1].type == Cb::cb_book_update);
+
+    REQUIRE(book.bids().size() == 2);
+    CHECK(book.bids().begin()->second.ptr() == other);
+    CHECK(std::next(book.bids().begin())->second.ptr() == amended);
+    CHECK(std::next(book.bids().begin())->second.open_qty() == 3);
+    CHECK(std::next(book.bids().begin())->second.filled_qty() == 1);
+
+    /* plugins see it leave and enter the book */
+    CHECK(book.user_orders_size(USER_1) == 1);
+    CHECK(book.cancel_user(USER_1) == 1);
+    CHECK(book.bids().size() == 1);
+  }
+
+  SUBCASE("a crossing amend trades first") {
+    book.add(std::make_shared<Order>(USER_2, SELL, 1005, 1, 0));
+
+    auto amended = std::make_shared<Order>(USER_1, BUY, 1005, 3, 0);
+    book.start_recording_callbacks();
+    book.amend(order, amended);
+
+    Book::Callbacks cb = book.get_recorded_callbacks();
+    REQUIRE(cb.size() == 3);
+    CHECK(cb[0].type == Cb::cb_order_replace);
+    CHECK(cb[1].type == Cb::cb_trade);
+    CHECK(cb[1].order == amended);
+    CHECK(cb[1].generic_2 == 2); /* taker's total filled qty */
+
+    CHECK(book.asks().empty());
+    CHECK(book.bids().begin()->second.ptr() == amended);
+    CHECK(book.bids().begin()->second.open_qty() == 1);
+  }
+
+  SUBCASE("rejected amends") {
+    book.start_recording_callbacks();
+
+    /* down to the filled qty */
+    book.amend(order, std::make_shared<Order>(USER_1, BUY, 990, 1, 0));
+    book.amend(order, std::make_shared<Order>(USER_1, BUY, 0, 3, 0));
+    book.amend(std::make_shared<Order>(USER_1, BUY, 1000, 3, 0),
+      std::make_shared<Order>(USER_1, BUY, 990, 3, 0));
+
+    Book::Callbacks cb = book.get_recorded_callbacks();
+    REQUIRE(cb.size() == 3);
+    CHECK(cb[0].reason == book::replace_reject_no_qty);
+    CHECK(cb[1].reason == book::replace_reject_invalid_price);
+    CHECK(cb[2].reason == book::replace_reject_not_found);
+
+    CHECK(book.bids().begin()->second.ptr() == order);
+  }
+
+  SUBCASE("depth moves the qty in one replace") {
+    TestDepthBook depth;
+    depth.add(1000, 2, BUY);
+    depth.add(999, 1, BUY);
+
+    book.start_recording_callbacks();
+    book.amend(order, std::make_shared<Order>(USER_1, BUY, 998, 3, 0));
+
+    Book::Callbacks cb = book.get_recorded_callbacks();
+    depth.on_replace(cb[0].order, cb[0].generic_2, cb[0].generic_1, cb[0].price);
+
+    const depth::DepthLevel* bids = depth.get_depth().bids();
+    CHECK(bids[0].price() == 999);
+    CHECK(bids[1].price() == 998);
+    CHECK(bids[1].aggregate_qty() == 2);
+    CHECK(bids[1].order_count() == 1);
+  }
+}
+
+}
@@ -0,0 +1,69 @@
+#include <doctest/doctest.h>
+#include <memory>
+#include <vector>
+
+#include <book/dispatcher.h>
+#include "fixtures/order.h"
+
+namespace dispatcher_test {
+
+typedef std::shared_ptr<fixtures::OrderWithUserID> OrderPtr;
+typedef book::CallbackDispatcher<OrderPtr> Dispatcher;
+typedef Dispatcher::TypedCallback Callback;
+
+Callback make(Callback::CbType type, Callback::CbScope scope) {
+  Callback cb;
+  cb.type = type;
+  cb.scope = scope;
+  return cb;
+}
+
+TEST_CASE("callback dispatcher") {
+  Dispatcher dispatcher;
+
+  std::vector<const Callback*> holds, depth, publisher, trades;
+
+  dispatcher.subscribe(Dispatcher::everyone, Dispatcher::all_types,
+    [&](const Dispatcher::Stream& s) { holds.insert(holds.end(), s.begin(), s.end()); });
+  dispatcher.subscribe(Dispatcher::internal, Dispatcher::all_types,
+    [&](const Dispatcher::Stream& s) { depth.insert(depth.end(), s.begin(), s.end()); });
+  dispatcher.subscribe(Dispatcher::external, Dispatcher::all_types,
+    [&](const Dispatcher::Stream& s) { publisher.insert(publisher.end(), s.begin(), s.end()); });
+  dispatcher.subscribe(Dispatcher::everyone,
+    Dispatcher::type_bit(Callback::cb_trade) | Dispatcher::type_bit(Callback::cb_level_fill),
+    [&](const Dispatcher::Stream& s) { trades.insert(trades.end(), s.begin(), s.end()); });
+
+  std::vector<Callback> callbacks = {
+    make(Callback::cb_order_accept, Callback::broadcast_to_all),
+    make(Callback::cb_trade, Callback::internal_only),
+    make(Callback::cb_trade, Callback::external_only),
+    make(Callback::cb_order_cancel, Callback::suppress_callback),
+    make(Callback::cb_level_fill, Callback::broadcast_to_all),
+    make(Callback::cb_book_update, Callback::broadcast_to_all)
+  };
+
+  dispatcher.dispatch(callbacks);
+
+  /* streams point into the batch, in its order */
+  CHECK(holds == std::vector<const Callback*>{
+    &callbacks[0], &callbacks[1], &callbacks[2], &callbacks[4], &callbacks[5] });
+  CHECK(depth == std::vector<const Callback*>{
+    &callbacks[0], &callbacks[1], &callbacks[4], &callbacks[5] });
+  CHECK(publisher == std::vector<const Callback*>{
+    &callbacks[0], &callbacks[2], &callbacks[4], &callbacks[5] });
+  CHECK(trades == std::vector<const Callback*>{
+    &callbacks[1], &callbacks[2], &callbacks[4] });
+
+  SUBCASE("subscribers with nothing to receive are not called") {
+    size_t calls = 0;
+    Dispatcher other;
+    other.subscribe(Dispatcher::external, Dispatcher::type_bit(Callback::cb_trade),
+      [&](const Dispatcher::Stream&) { ++calls; });
+
+    std::vector<Callback> batch = { make(Callback::cb_trade, Callback::internal_only) };
+    other.dispatch(batch);
+    CHECK(calls == 0);
+  }
+}
+
+}
@@ -0,0 +1,202 @@
+#include <doctest/doctest.h>
+#include <memory>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+#include <book/ob.h>
+#include <book/execution_reports.h>
+#include <utils/shm_ring.h>
+#include "fixtures/order.h"
+
+namespace execution_reports_test {
+
+#define SYMBOL_ID_1 1
+#define USER_1 1
+#define USER_2 2
+
+#define BUY true
+#define SELL false
+
+typedef fixtures::OrderWithUserID Order;
+typedef std::shared_ptr<Order> OrderPtr;
+typedef book::ComposeTracker<OrderPtr> Tracker;
+typedef book::OB<Tracker> Book_;
+
+class Book : public Book_ {
+public:
+  Book(utils::ShmRingWriter& ring) :
+    Book_(SYMBOL_ID_1), publisher_(ring, SYMBOL_ID_1) {}
+
+protected:
+  void on_callbacks(const Callbacks& callbacks) {
+    publisher_.publish(callbacks, maker_fills());
+  }
+
+private:
+  book::sbe::ExecutionReportPublisher<OrderPtr> publisher_;
+};
+
+OrderPtr order(uint64_t id, bool is_bid, double price, double qty) {
+  OrderPtr order = std::make_shared<Order>(is_bid ? USER_1 : USER_2, is_bid, price, qty, 0);
+  order->order_id(utils::uint128(7, id));
+  return order;
+}
+
+
+TEST_CASE("execution reports") {
+  const std::string name = "/eigenbasis_test_reports_" + std::to_string(getpid());
+
+  SUBCASE("published through a shared-memory ring") {
+    utils::ShmRingWriter ring(name, 1 << 12);
+    utils::ShmRingReader reader(name);
+    Book book(ring);
+
+    book.add(order(1, SELL, 100, 1.0));
+    book.add(order(2, SELL, 100, 2.0));
+    book.add(order(3, BUY, 100, 3.0));
+
+    std::vector<book::sbe::ExecutionReport> reports;
+    std::vector<book::sbe::MakerFillEntry> fills;
+
+    reader.poll([&](const char* data, size_t length) {
+      book::sbe::ExecutionReportDecoder decoder;
+      REQUIRE(decoder.wrap(data, length));
+      CHECK(decoder.header().version == book::sbe::SCHEMA_VERSION);
+
+      reports.push_back(decoder.report());
+      for(uint32_t i = 0; i < decoder.maker_fills_count(); ++i)
+        fills.push_back(decoder.maker_fill(i));
+    });
+
+    /* 2 x (accept, book update), accept, level fill, book update */
+    REQUIRE(reports.size() == 7);
+    CHECK(reports[4].type == Book::TypedCallback::cb_order_accept);
+    CHECK(reports[4].order_id_lo == 3);
+    CHECK(reports[4].qty == 3.0);
+
+    const book::sbe::ExecutionReport& fill = reports[5];
+    CHECK(fill.type == Book::TypedCallback::cb_level_fill);
+    CHECK(fill.symbol_id == SYMBOL_ID_1);
+    CHECK(fill.order_id_hi == 7);
+    CHECK(fill.order_id_lo == 3);
+    CHECK(fill.qty == 3.0);
+    CHECK(fill.price == 100);
+    CHECK(fill.ts != 0);
+
+    REQUIRE(fills.size() == 2);
+    CHECK(fills[0].order_id_lo == 1);
+    CHECK(fills[0].qty == 1.0);
+    CHECK(fills[1].order_id_lo == 2);
+    CHECK(fills[1].qty == 2.0);
+
+    CHECK(reader.lost() == 0);
+  }
+
+  SUBCASE("frames wrap around the ring, slow readers are told") {
+    utils::ShmRingWriter ring(name, 256);
+    utils::ShmRingReader reader(name);
+
+    size_t read = 0;
+    for(uint64_t i = 0; i < 100; ++i) {
+      char* out = ring.reserve(sizeof(uint64_t) * 3);
+      memcpy(out, &i, sizeof(i));
+      ring.commit(sizeof(uint64_t) * 3);
+
+      reader.poll([&](const char* data, size_t length) {
+        uint64_t value;
+        memcpy(&value, data, sizeof(value));
+        CHECK(value == read);
+        CHECK(length == sizeof(uint64_t) * 3);
+        ++read;
+      });
+    }
+
+    CHECK(read == 100);
+    CHECK(reader.lost() == 0);
+
+    /* 20 frames of 32 bytes lap the 256 bytes ring */
+    for(int i = 0; i < 20; ++i) {
+      ring.reserve(24);
+      ring.commit(24);
+    }
+
+    reader.poll([](const char*, size_t) {});
+    CHECK(reader.lost() == 1);
+  }
+
+  SUBCASE("frames overwritten while being read are not handed over") {
+    utils::ShmRingWriter ring(name, 256);
+    utils::ShmRingReader reader(name);
+
+    /* 7 frames of 32 bytes, each filled with its index */
+    for(char i = 0; i < 7; ++i) {
+      memset(ring.reserve(24), i, 24);
+      ring.commit(24);
+    }
+
+    std::vector<std::string> frames;
+    auto on_frame = [&](const char* data, size_t length) {
+      frames.push_back(std::string(data, length));
+
+      /* the writer laps the reader from within the first frame */
+      if(frames.size() == 1) {
+        for(int i = 0; i < 10; ++i) {
+          memset(ring.reserve(40), 0x7f, 40);
+          ring.commit(40);
+        }
+      }
+    };
+
+    CHECK(reader.poll(on_frame) == 1);
+    CHECK(reader.lost() == 1);
+    REQUIRE(frames.size() == 1);
+    CHECK(frames[0] == std::string(24, 0));
+
+    /* a frame being written, not yet committed, over ones not read */
+    frames.clear();
+    for(char i = 0; i < 7; ++i) {
+      memset(ring.reserve(24), i, 24);
+      ring.commit(24);
+    }
+
+    utils::ShmRingReader behind(name);
+    for(char i = 0; i < 7; ++i) {
+      memset(ring.reserve(24), i, 24);
+      ring.commit(24);
+    }
+
+    memset(ring.reserve(56), 0x7f, 56);
+
+    CHECK(behind.poll(on_frame) == 0);
+    CHECK(behind.lost() == 1);
+    CHECK(frames.empty());
+
+    ring.commit(56);
+    CHECK(behind.poll(on_frame) == 1);
+    CHECK(frames[0] == std::string(56, 0x7f));
+  }
+
+  SUBCASE("decoders skip fields appended by later versions") {
+    std::vector<char> buffer(512, 0);
+    book::sbe::MessageHeader header = { sizeof(book::sbe::ExecutionReport) + 8,
+      book::sbe::EXECUTION_REPORT_ID, book::sbe::SCHEMA_ID, book::sbe::SCHEMA_VERSION + 1 };
+    book::sbe::GroupHeader group = { sizeof(book::sbe::MakerFillEntry), 0, 1 };
+    book::sbe::MakerFillEntry entry = { 0, 42, 1.5 };
+
+    char* at = buffer.data();
+    memcpy(at, &header, sizeof(header));
+    at += sizeof(header) + header.block_length;
+    memcpy(at, &group, sizeof(group));
+    memcpy(at + sizeof(group), &entry, sizeof(entry));
+
+    book::sbe::ExecutionReportDecoder decoder;
+    REQUIRE(decoder.wrap(buffer.data(), buffer.size()));
+    REQUIRE(decoder.maker_fills_count() == 1);
+    CHECK(decoder.maker_fill(0).order_id_lo == 42);
+
+    CHECK(!decoder.wrap(buffer.data(), 64));
+  }
+}
+
+}
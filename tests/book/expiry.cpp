@@ -0,0 +1,172 @@
+#include <doctest/doctest.h>
+#include <memory>
+#include <vector>
+#include <random>
+#include <algorithm>
+
+#include <book/types.h>
+#include <book/plugins/expiry.h>
+#include <utils/timing_wheel.h>
+#include "fixtures/order.h"
+#include "fixtures/me.h"
+
+#define SYMBOL_ID_1 1
+#define USER_1 1
+#define USER_2 2
+
+#define BUY true
+#define SELL false
+
+namespace expiry_test {
+
+typedef fixtures::OrderWithExpiry Order;
+typedef std::shared_ptr<Order> OrderPtr;
+
+typedef book::ComposeTracker<OrderPtr,
+  book::plugins::ExpiryTracker> Tracker;
+
+typedef fixtures::ME<
+  Tracker,
+  book::plugins::ExpiryPlugin<Tracker>
+> Book;
+
+const uint64_t MS = 1000000;
+const uint64_t SEC = 1000 * MS;
+
+
+TEST_CASE("timing wheel") {
+  utils::TimingWheel<uint64_t> wheel(MS);
+
+  SUBCASE("timers fire in tick order across levels") {
+    std::mt19937_64 rng(7);
+    std::vector<uint64_t> due;
+
+    /* from the next ms to beyond the 2^32 ms of the wheel's levels */
+    for(int i = 0; i < 2000; ++i) {
+      uint64_t at = (rng() % (1ull << (8 + 4 * (i % 8)))) * MS;
+      wheel.schedule(at, at / MS);
+      due.push_back(at / MS);
+    }
+
+    std::sort(due.begin(), due.end());
+
+    std::vector<uint64_t> fired;
+    uint64_t now = 0;
+    while(!wheel.empty()) {
+      now += (rng() % 1000000) * MS;
+      wheel.advance(now, [&](uint64_t tick) {
+        CHECK(tick <= now / MS);
+        fired.push_back(tick);
+      });
+    }
+
+    CHECK(fired == due);
+  }
+
+  SUBCASE("timers far from the wheel's time") {
+    /* a wall clock time, many overflow blocks from 0 */
+    const uint64_t t0 = 1700000000000ull * MS;
+
+    for(uint64_t i = 0; i < 1000; ++i)
+      wheel.schedule(t0 + (i % 100) * MS, i % 100);
+    wheel.schedule(t0 + (1ull << 33) * MS, 1000);
+
+    std::vector<uint64_t> fired;
+    auto collect = [&](uint64_t value) { fired.push_back(value); };
+
+    CHECK(wheel.advance(t0 - 1, collect) == 0);
+    CHECK(wheel.advance(t0 + 99 * MS, collect) == 1000);
+    CHECK(std::is_sorted(fired.begin(), fired.end()));
+
+    CHECK(wheel.advance(t0 + ((1ull << 33) - 1) * MS, collect) == 0);
+    CHECK(wheel.advance(t0 + (1ull << 33) * MS, collect) == 1);
+    CHECK(fired.back() == 1000);
+
+    /* and seeded with the time */
+    utils::TimingWheel<uint64_t> seeded(MS);
+    seeded.seed(t0);
+    seeded.schedule(t0 + 5 * MS, 5);
+    CHECK(seeded.advance(t0 + 4 * MS, collect) == 0);
+    CHECK(seeded.advance(t0 + 5 * MS, collect) == 1);
+  }
+
+  SUBCASE("cancelled timers don't fire, limits split a batch") {
+    uint32_t a = wheel.schedule(10 * MS, 1);
+    wheel.schedule(10 * MS, 2);
+    wheel.schedule(10 * MS, 3);
+    wheel.schedule(300 * MS, 4);
+    wheel.cancel(a);
+
+    std::vector<uint64_t> fired;
+    auto collect = [&](uint64_t value) { fired.push_back(value); };
+
+    CHECK(wheel.advance(9 * MS, collect) == 0);
+    CHECK(wheel.advance(10 * MS, collect, 1) == 1);
+    CHECK(wheel.advance(10 * MS, collect, 1) == 1);
+    CHECK(wheel.advance(400 * MS, collect) == 1);
+    CHECK(fired == std::vector<uint64_t>{ 3, 2, 4 });
+    CHECK(wheel.empty());
+  }
+}
+
+
+TEST_CASE("order expiry") {
+  Book book(SYMBOL_ID_1);
+
+  OrderPtr gtc = std::make_shared<Order>(USER_1, BUY, 1000, 1.0, 0);
+  OrderPtr day1 = std::make_shared<Order>(USER_1, BUY, 999, 1.0, 0, 60 * SEC);
+  OrderPtr day2 = std::make_shared<Order>(USER_2, SELL, 1010, 1.0, 0, 60 * SEC);
+  OrderPtr gtt = std::make_shared<Order>(USER_2, SELL, 1011, 1.0, 0, 3600 * SEC);
+
+  for(auto& order : { gtc, day1, day2, gtt }) book.add(order);
+  CHECK(book.expiring_orders_size() == 3);
+
+  SUBCASE("orders due at the same time expire in one batch") {
+    CHECK(book.expire_orders(59 * SEC) == 0);
+
+    book.start_recording_callbacks();
+    CHECK(book.expire_orders(60 * SEC) == 2);
+    Book::Callbacks cb = book.get_recorded_callbacks();
+
+    REQUIRE(cb.size() == 3);
+    CHECK(cb[0].type == Book::TypedCallback::cb_order_cancel);
+    CHECK(cb[0].reason == book::order_expired);
+    CHECK(cb[1].type == Book::TypedCallback::cb_order_cancel);
+    CHECK(cb[2].type == Book::TypedCallback::cb_book_update);
+
+    CHECK(book.bids().size() == 1);
+    CHECK(book.asks().size() == 1);
+
+    CHECK(book.expire_orders(3600 * SEC) == 1);
+    CHECK(book.asks().empty());
+    CHECK(book.bids().begin()->second.ptr() == gtc);
+  }
+
+  SUBCASE("orders expiring on the wall clock") {
+    Book wall_book(SYMBOL_ID_1);
+    const uint64_t now = utils::wall_ns();
+
+    OrderPtr day = std::make_shared<Order>(USER_1, BUY, 999, 1.0, 0, now + 60 * SEC);
+    OrderPtr gtd = std::make_shared<Order>(USER_1, BUY, 998, 1.0, 0, now + 30 * SEC);
+    wall_book.add(day);
+    wall_book.add(gtd);
+
+    CHECK(wall_book.expire_orders(now + 29 * SEC) == 0);
+    CHECK(wall_book.expire_orders(now + 30 * SEC) == 1);
+    CHECK(wall_book.bids().begin()->second.ptr() == day);
+    CHECK(wall_book.expire_orders(now + 60 * SEC) == 1);
+    CHECK(wall_book.bids().empty());
+  }
+
+  SUBCASE("filled and cancelled orders are unscheduled") {
+    book.add(std::make_shared<Order>(USER_1, BUY, 1010, 1.0, 0));
+    book.cancel(gtt, book::user_cancel);
+    CHECK(book.expiring_orders_size() == 1);
+
+    CHECK(book.expire_orders(7200 * SEC) == 1);
+    CHECK(book.asks().empty());
+    CHECK(book.bids().size() == 1);
+  }
+}
+
+}
@@ -14,6 +14,7 @@ class ME : public book::OB<Tracker, Plugins...> {
 public:
   typedef typename Tracker::OrderPtr OrderPtr;
   typedef std::vector<typename book::OB<Tracker, Plugins...>::TypedCallback> Callbacks;
+  typedef typename book::OB<Tracker, Plugins...>::MakerFills MakerFills;
 
   ME(uint32_t symbol_id);
   Callbacks add_and_get_cbs(const OrderPtr& order);
@@ -26,6 +27,9 @@ public:
     callbacks.swap(recorded_callbacks_);
   }
 
+  /* maker_fills() of the last callbacks, which the book clears */
+  const MakerFills& last_maker_fills() const { return maker_fills_; }
+
   Callbacks get_recorded_callbacks() {
     Callbacks callbacks;
     callbacks.swap(recorded_callbacks_);
@@ -35,6 +39,7 @@ public:
 private:
   bool recording_callbacks_;
   Callbacks callbacks_;
+  MakerFills maker_fills_;
   Callbacks recorded_callbacks_;
 };
 
@@ -55,6 +60,7 @@ typename ME<Tracker, Plugins...>::Callbacks ME<Tracker, Plugins...>::add_and_get
 template <class Tracker, class... Plugins>
 void ME<Tracker, Plugins...>::on_callbacks(const ME<Tracker, Plugins...>::Callbacks& callbacks) {
   callbacks_ = callbacks;
+  maker_fills_ = this->maker_fills();
 
   if(recording_callbacks_) {
     for(auto cb : callbacks) {
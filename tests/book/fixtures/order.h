@@ -4,6 +4,7 @@
 #include <book/plugins/post_only.h>
 #include <book/plugins/reduce_only.h>
 #include <book/plugins/stop_orders.h>
+#include <book/plugins/expiry.h>
 
 #include <utils/uint128.h>
 
@@ -11,7 +12,7 @@ namespace fixtures {
 using namespace book::plugins;
 using namespace utils;
 
-class OrderWithUserID : public book::Order, public SelfTradePolicyOrder {
+class OrderWithUserID {
 public:
   OrderWithUserID(
     uint32_t user_id,
@@ -43,7 +44,7 @@ protected:
   SelfTradePolicy stp_;
 };
 
-class OrderWithPostOnly : public OrderWithUserID, public PostOnlyOrder {
+class OrderWithPostOnly : public OrderWithUserID {
 public:
   OrderWithPostOnly(
     uint32_t user_id,
@@ -63,7 +64,7 @@ private:
   bool post_only_;
 };
 
-class OrderWithReduceOnly : public OrderWithUserID, public ReduceOnlyOrder {
+class OrderWithReduceOnly : public OrderWithUserID {
 public:
   OrderWithReduceOnly(
     uint32_t user_id,
@@ -84,7 +85,7 @@ private:
 };
 
 
-class OrderWithStopPrice : public OrderWithUserID, public StopOrder {
+class OrderWithStopPrice : public OrderWithUserID {
 public:
   OrderWithStopPrice(
     uint32_t user_id,
@@ -92,16 +93,50 @@ public:
     double price,
     double qty,
     double funds,
-    double stop_price = 0) :
+    double stop_price = 0,
+    TrailingType trailing_type = trail_none,
+    double trailing_offset = 0) :
       OrderWithUserID(user_id, is_bid, price, qty, funds),
-       stop_price_(stop_price) { }
+       stop_price_(stop_price), trailing_type_(trailing_type),
+       trailing_offset_(trailing_offset) { }
 
   double stop_price() const {
     return stop_price_;
   }
 
+  TrailingType trailing_type() const {
+    return trailing_type_;
+  }
+
+  double trailing_offset() const {
+    return trailing_offset_;
+  }
+
 private:
   double stop_price_;
+  TrailingType trailing_type_;
+  double trailing_offset_;
+};
+
+
+class OrderWithExpiry : public OrderWithUserID {
+public:
+  OrderWithExpiry(
+    uint32_t user_id,
+    bool is_bid,
+    double price,
+    double qty,
+    double funds,
+    uint64_t expire_at = 0) :
+      OrderWithUserID(user_id, is_bid, price, qty, funds),
+       expire_at_(expire_at) { }
+
+  uint64_t expire_at() const {
+    return expire_at_;
+  }
+
+private:
+  uint64_t expire_at_;
 };
 
 
@@ -0,0 +1,97 @@
+#include <doctest/doctest.h>
+#include <memory>
+#include <vector>
+
+#include <book/types.h>
+#include <book/plugins/stop_orders.h>
+#include <book/plugins/mass_cancel.h>
+#include "fixtures/order.h"
+#include "fixtures/me.h"
+
+#define SYMBOL_ID_1 1
+#define USER_1 1
+#define USER_2 2
+
+#define BUY true
+#define SELL false
+
+namespace halt_test {
+
+typedef fixtures::OrderWithStopPrice Order;
+typedef std::shared_ptr<Order> OrderPtr;
+
+typedef book::ComposeTracker<OrderPtr,
+  book::plugins::MassCancelTracker> Tracker;
+
+typedef fixtures::ME<
+  Tracker,
+  book::plugins::StopOrdersPlugin<Tracker>,
+  book::plugins::MassCancelPlugin<Tracker>
+> Book;
+
+
+TEST_CASE("halt and resume") {
+  Book book(SYMBOL_ID_1);
+
+  std::vector<OrderPtr> resting;
+  for(int i = 0; i < 3; ++i) {
+    resting.push_back(std::make_shared<Order>(USER_1, BUY, 1000 - i, 1.0, 0));
+    resting.push_back(std::make_shared<Order>(USER_2, SELL, 1010 + i, 1.0, 0));
+  }
+  for(auto& order : resting) book.add(order);
+
+  /* sets the market price, then a stop and a trailing stop */
+  book.add(std::make_shared<Order>(USER_1, BUY, 1010, 0.5, 0));
+  book.add(std::make_shared<Order>(USER_1, BUY, 1, 1.0, 0, 1050));
+  book.add(std::make_shared<Order>(USER_2, SELL, 100000, 1.0, 0, 0,
+    book::plugins::trail_absolute, 10));
+
+  book.start_recording_callbacks();
+  book.halt();
+  Book::Callbacks cb = book.get_recorded_callbacks();
+
+  SUBCASE("halting cancels resting orders and stops in one batch") {
+    REQUIRE(cb.size() == 9);
+    for(size_t i = 0; i < 8; ++i) {
+      CHECK(cb[i].type == Book::TypedCallback::cb_order_cancel);
+      CHECK(cb[i].reason == book::engine_shutdown);
+    }
+    CHECK(cb[8].type == Book::TypedCallback::cb_book_update);
+
+    CHECK(book.halted());
+    CHECK(book.bids().empty());
+    CHECK(book.asks().empty());
+    CHECK(book.user_orders_size(USER_1) == 0);
+    CHECK(book.cancel_user(USER_2) == 0);
+  }
+
+  SUBCASE("orders are rejected while halted") {
+    Book::Callbacks cb = book.add_and_get_cbs(
+      std::make_shared<Order>(USER_1, BUY, 1000, 1.0, 0));
+
+    REQUIRE(cb.size() == 1);
+    CHECK(cb[0].type == Book::TypedCallback::cb_order_reject);
+    CHECK(cb[0].reason == book::book_halted);
+  }
+
+  SUBCASE("resuming restores orders in one batch") {
+    book.start_recording_callbacks();
+    book.resume(resting);
+    Book::Callbacks cb = book.get_recorded_callbacks();
+
+    CHECK(!book.halted());
+    REQUIRE(cb.size() == 7);
+    for(size_t i = 0; i < 6; ++i)
+      CHECK(cb[i].type == Book::TypedCallback::cb_order_accept);
+    CHECK(cb[6].type == Book::TypedCallback::cb_book_update);
+
+    CHECK(book.bids().size() == 3);
+    CHECK(book.asks().size() == 3);
+    CHECK(book.user_orders_size(USER_1) == 3);
+
+    book.add(std::make_shared<Order>(USER_2, SELL, 1000, 1.0, 0));
+    CHECK(book.bids().size() == 2);
+  }
+}
+
+}
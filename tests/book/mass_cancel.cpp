@@ -0,0 +1,155 @@
+#include <doctest/doctest.h>
+#include <memory>
+
+#include <book/types.h>
+#include <book/plugins/mass_cancel.h>
+#include "fixtures/order.h"
+#include "fixtures/me.h"
+
+#define SYMBOL_ID_1 1
+#define USER_1 1
+#define USER_2 2
+
+#define BUY true
+#define SELL false
+
+namespace mass_cancel_test {
+
+typedef fixtures::OrderWithUserID Order;
+typedef std::shared_ptr<Order> OrderPtr;
+
+typedef book::ComposeTracker<OrderPtr,
+  book::plugins::MassCancelTracker> Tracker;
+
+typedef fixtures::ME<
+  Tracker,
+  book::plugins::MassCancelPlugin<Tracker>
+> Book;
+
+/* cancels the orders of the maker's user as soon as it trades */
+template <class Tracker>
+class CancelMakerUser : public book::plugins::MassCancelPlugin<Tracker> {
+public:
+  size_t cancelled = 0;
+
+protected:
+  void after_trade(Tracker& taker, Tracker& maker, bool maker_is_bid,
+    double qty, double price)
+  {
+    cancelled = this->cancel_user(maker.user_id());
+  }
+};
+
+typedef fixtures::ME<
+  Tracker,
+  CancelMakerUser<Tracker>
+> CancellingBook;
+
+
+TEST_CASE("mass cancel") {
+  Book book(SYMBOL_ID_1);
+
+  for(int i = 0; i < 3; ++i) {
+    book.add(std::make_shared<Order>(USER_1, BUY, 1000 - i, 1.0, 0));
+    book.add(std::make_shared<Order>(USER_1, SELL, 1010 + i, 1.0, 0));
+    book.add(std::make_shared<Order>(USER_2, BUY, 1000 - i, 1.0, 0));
+    book.add(std::make_shared<Order>(USER_2, SELL, 1010 + i, 1.0, 0));
+  }
+
+  CHECK(book.user_orders_size(USER_1) == 6);
+
+  SUBCASE("all orders of a user") {
+    book.start_recording_callbacks();
+    CHECK(book.cancel_user(USER_1) == 6);
+
+    Book::Callbacks cb = book.get_recorded_callbacks();
+    REQUIRE(cb.size() == 7);
+    for(size_t i = 0; i < 6; ++i) {
+      CHECK(cb[i].type == Book::TypedCallback::cb_order_cancel);
+      CHECK(cb[i].order->user_id() == USER_1);
+      CHECK(cb[i].reason == book::user_cancel);
+    }
+    CHECK(cb[6].type == Book::TypedCallback::cb_book_update);
+
+    CHECK(book.user_orders_size(USER_1) == 0);
+    CHECK(book.user_orders_size(USER_2) == 6);
+    CHECK(book.bids().size() == 3);
+    CHECK(book.asks().size() == 3);
+
+    CHECK(book.cancel_user(USER_1) == 0);
+  }
+
+  SUBCASE("one side of a user") {
+    CHECK(book.cancel_user(USER_2, SELL, book::engine_shutdown) == 3);
+
+    CHECK(book.user_orders_size(USER_2) == 3);
+    CHECK(book.bids().size() == 6);
+    CHECK(book.asks().size() == 3);
+    for(auto& entry : book.asks())
+      CHECK(entry.second.user_id() == USER_1);
+  }
+
+  SUBCASE("a price range of a side") {
+    book.start_recording_callbacks();
+    CHECK(book.cancel_range(BUY, 999, 1000) == 4);
+
+    Book::Callbacks cb = book.get_recorded_callbacks();
+    REQUIRE(cb.size() == 5);
+    CHECK(cb[0].order->price() == 1000);
+    CHECK(cb[3].order->price() == 999);
+    CHECK(cb[4].type == Book::TypedCallback::cb_book_update);
+
+    CHECK(book.bids().size() == 2);
+    CHECK(book.bids().begin()->second.price() == 998);
+    CHECK(book.user_orders_size(USER_1) == 4);
+
+    CHECK(book.cancel_range(SELL, 0, 1011) == 4);
+    CHECK(book.asks().size() == 2);
+  }
+
+  SUBCASE("a price range of bids from 0") {
+    book.start_recording_callbacks();
+
+    /* nothing rests at 0 or below */
+    CHECK(book.cancel_range(BUY, 0, 0) == 0);
+    CHECK(book.cancel_range(BUY, -10, -1) == 0);
+    CHECK(book.bids().size() == 6);
+    CHECK(book.get_recorded_callbacks().empty());
+
+    CHECK(book.cancel_range(BUY, 0, 999) == 4);
+    CHECK(book.bids().size() == 2);
+    CHECK(book.bids().begin()->second.price() == 1000);
+  }
+
+  SUBCASE("filled makers leave the index") {
+    book.add(std::make_shared<Order>(USER_2, SELL, 1000, 2.0, 0));
+    CHECK(book.user_orders_size(USER_1) == 5);
+    CHECK(book.user_orders_size(USER_2) == 5);
+  }
+}
+
+
+TEST_CASE("mass cancel during a match") {
+  CancellingBook book(SYMBOL_ID_1);
+
+  for(int i = 0; i < 3; ++i) {
+    book.add(std::make_shared<Order>(USER_1, BUY, 1000 - i, 1.0, 0));
+    book.add(std::make_shared<Order>(USER_1, SELL, 1010 + i, 1.0, 0));
+  }
+
+  /* the maker filled is left to the match, and not counted */
+  book.start_recording_callbacks();
+  book.add(std::make_shared<Order>(USER_2, SELL, 1000, 1.0, 0));
+  CHECK(book.cancelled == 5);
+
+  size_t cancels = 0;
+  for(auto& cb : book.get_recorded_callbacks())
+    cancels += cb.type == CancellingBook::TypedCallback::cb_order_cancel;
+  CHECK(cancels == 5);
+
+  CHECK(book.user_orders_size(USER_1) == 0);
+  CHECK(book.bids().empty());
+  CHECK(book.asks().empty());
+}
+
+}
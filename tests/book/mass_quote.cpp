@@ -0,0 +1,173 @@
+#include <doctest/doctest.h>
+#include <memory>
+#include <vector>
+
+#include <book/types.h>
+#include <book/plugins/mass_quote.h>
+#include "fixtures/order.h"
+#include "fixtures/me.h"
+
+#define SYMBOL_ID_1 1
+#define USER_1 1
+#define USER_2 2
+
+#define BUY true
+#define SELL false
+
+namespace mass_quote_test {
+
+typedef fixtures::OrderWithUserID Order;
+typedef std::shared_ptr<Order> OrderPtr;
+
+typedef book::ComposeTracker<OrderPtr,
+  book::plugins::MassQuoteTracker> Tracker;
+
+typedef fixtures::ME<
+  Tracker,
+  book::plugins::MassQuotePlugin<Tracker>
+> Book;
+
+typedef Book::TypedCallback Cb;
+
+OrderPtr quote(bool is_bid, double price, double qty) {
+  return std::make_shared<Order>(USER_1, is_bid, price, qty, 0);
+}
+
+size_t count(const Book::Callbacks& cb, Cb::CbType type) {
+  size_t n = 0;
+  for(auto& callback : cb) n += callback.type == type;
+  return n;
+}
+
+
+TEST_CASE("mass quote") {
+  Book book(SYMBOL_ID_1);
+
+  book.start_recording_callbacks();
+  CHECK(book.mass_quote(USER_1, {
+    quote(BUY, 1000, 2), quote(BUY, 999, 2), quote(BUY, 998, 2),
+    quote(SELL, 1010, 2), quote(SELL, 1011, 2) }) == 5);
+
+  Book::Callbacks cb = book.get_recorded_callbacks();
+  CHECK(count(cb, Cb::cb_order_accept) == 5);
+  CHECK(count(cb, Cb::cb_book_update) == 1);
+  CHECK(cb.back().type == Cb::cb_book_update);
+  CHECK(book.quotes_size(USER_1) == 5);
+
+  /* another user behind the quote at 1000 */
+  auto other = std::make_shared<Order>(USER_2, BUY, 1000, 1, 0);
+  book.add(other);
+
+  SUBCASE("an unchanged ladder changes nothing") {
+    book.start_recording_callbacks();
+    CHECK(book.mass_quote(USER_1, {
+      quote(BUY, 1000, 2), quote(BUY, 999, 2), quote(BUY, 998, 2),
+      quote(SELL, 1010, 2), quote(SELL, 1011, 2) }) == 0);
+
+    cb = book.get_recorded_callbacks();
+    REQUIRE(cb.size() == 1);
+    CHECK(cb[0].type == Cb::cb_book_update);
+  }
+
+  SUBCASE("levels are cancelled, reduced, re-added and added") {
+    book.start_recording_callbacks();
+    CHECK(book.mass_quote(USER_1, {
+      quote(BUY, 1000, 1),   /* reduced */
+      quote(BUY, 999, 3),    /* rises: re-added */
+      quote(BUY, 998, 0),    /* pulled */
+      quote(BUY, 997, 2),    /* new */
+      quote(SELL, 1011, 2)   /* 1010 left out */
+    }) == 5);
+
+    cb = book.get_recorded_callbacks();
+    CHECK(count(cb, Cb::cb_order_cancel) == 3);
+    CHECK(count(cb, Cb::cb_order_replace) == 1);
+    CHECK(count(cb, Cb::cb_order_accept) == 2);
+    CHECK(count(cb, Cb::cb_book_update) == 1);
+
+    /* cancels come first */
+    CHECK(cb[0].type == Cb::cb_order_cancel);
+    CHECK(cb[1].type == Cb::cb_order_cancel);
+    CHECK(cb[2].type == Cb::cb_order_cancel);
+
+    CHECK(book.quotes_size(USER_1) == 4);
+    CHECK(book.bids().size() == 4);
+    CHECK(book.asks().size() == 1);
+
+    /* the reduced quote kept its priority at 1000 */
+    CHECK(book.bids().begin()->second.user_id() == USER_1);
+    CHECK(book.bids().begin()->second.open_qty() == 1);
+  }
+
+  SUBCASE("a rising level goes to the back") {
+    book.mass_quote(USER_1, { quote(BUY, 1000, 5) });
+
+    CHECK(book.bids().size() == 2);
+    CHECK(book.bids().begin()->second.ptr() == other);
+    CHECK(book.quotes_size(USER_1) == 1);
+  }
+
+  SUBCASE("filled quotes leave the ladder") {
+    book.add(std::make_shared<Order>(USER_2, SELL, 1000, 2, 0));
+    CHECK(book.quotes_size(USER_1) == 4);
+
+    /* requoting the filled level adds it again */
+    CHECK(book.mass_quote(USER_1, {
+      quote(BUY, 1000, 2), quote(BUY, 999, 2), quote(BUY, 998, 2),
+      quote(SELL, 1010, 2), quote(SELL, 1011, 2) }) == 1);
+    CHECK(book.quotes_size(USER_1) == 5);
+  }
+
+  SUBCASE("an amended quote stays in the ladder") {
+    OrderPtr last = std::prev(book.bids().end())->second.ptr();
+    auto amended = quote(BUY, 1001, 2);
+    book.amend(last, amended);
+
+    CHECK(book.quotes_size(USER_1) == 5);
+    CHECK(book.bids().begin()->second.ptr() == amended);
+
+    /* and is diffed as one */
+    CHECK(book.mass_quote(USER_1, {
+      quote(BUY, 1001, 2), quote(BUY, 1000, 2), quote(BUY, 999, 2),
+      quote(SELL, 1010, 2), quote(SELL, 1011, 2) }) == 0);
+    CHECK(book.mass_quote(USER_1, {}) == 5);
+    CHECK(book.bids().size() == 1);
+  }
+
+  SUBCASE("orders that are not quotes are left alone") {
+    book.add(std::make_shared<Order>(USER_1, BUY, 990, 1, 0));
+    book.mass_quote(USER_1, {});
+
+    CHECK(book.quotes_size(USER_1) == 0);
+    CHECK(book.bids().size() == 2);
+    CHECK(book.asks().size() == 0);
+  }
+
+  SUBCASE("users without quotes left are forgotten") {
+    CHECK(book.quoting_users_size() == 1);
+
+    /* pulled */
+    book.mass_quote(USER_1, {});
+    CHECK(book.quoting_users_size() == 0);
+
+    /* an empty ladder of a user who never quoted */
+    CHECK(book.mass_quote(USER_2, {}) == 0);
+    CHECK(book.quoting_users_size() == 0);
+
+    /* filled */
+    book.mass_quote(USER_1, { quote(SELL, 1010, 2) });
+    CHECK(book.quoting_users_size() == 1);
+    book.add(std::make_shared<Order>(USER_2, BUY, 1010, 2, 0));
+    CHECK(book.quoting_users_size() == 0);
+  }
+
+  SUBCASE("invalid ladders") {
+    CHECK_THROWS_AS(book.mass_quote(USER_1, { quote(BUY, 990, 1), quote(BUY, 990, 2) }),
+      std::invalid_argument);
+    CHECK_THROWS_AS(book.mass_quote(USER_2, { quote(BUY, 990, 1) }),
+      std::invalid_argument);
+    CHECK(book.quotes_size(USER_1) == 5);
+  }
+}
+
+}
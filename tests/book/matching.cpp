@@ -1,5 +1,6 @@
 #include <doctest/doctest.h>
 #include <memory>
+#include <vector>
 #include <cmath>
 
 #include <book/types.h>
@@ -22,14 +23,8 @@ typedef fixtures::OrderWithUserID Order;
 typedef std::shared_ptr<Order> OrderPtr;
 
 
-struct Tracker :
-  public virtual book::BaseTracker<OrderPtr>,
-  public book::plugins::SelfTradePolicyTracker<OrderPtr>
-{
-  Tracker(const OrderPtr& order) :
-    book::BaseTracker<OrderPtr>(order),
-    book::plugins::SelfTradePolicyTracker<OrderPtr>(order) {}
-};
+typedef book::ComposeTracker<OrderPtr,
+  book::plugins::SelfTradePolicyTracker> Tracker;
 
 
 typedef fixtures::ME<
@@ -197,6 +192,86 @@ TEST_CASE("matching") {
 
 
 
+  SUBCASE("market buy by funds sweeping levels of several makers") {
+    const double p1 = 1000.00;
+    const double p2 = 1000.50;
+    const double f = 0.6 * p1 + 0.4 * p2 + 0.123456789 * p2;
+
+    book.add_and_get_cbs(std::make_shared<Order>(USER_1, SELL, p1, 0.1, 0));
+    book.add_and_get_cbs(std::make_shared<Order>(USER_1, SELL, p1, 0.2, 0));
+    book.add_and_get_cbs(std::make_shared<Order>(USER_1, SELL, p1, 0.3, 0));
+    book.add_and_get_cbs(std::make_shared<Order>(USER_1, SELL, p2, 0.4, 0));
+    book.add_and_get_cbs(std::make_shared<Order>(USER_1, SELL, p2, 0.5, 0));
+
+    Book::Callbacks cb = book.add_and_get_cbs(std::make_shared<Order>(USER_2, BUY, 0, 0, f));
+
+    CHECK(cb.size() == 7);
+    CHECK(cb[1].qty == 0.1);
+    CHECK(cb[2].qty == 0.2);
+    CHECK(cb[3].qty == 0.3);
+    CHECK(cb[4].qty == 0.4);
+    CHECK(cb[4].price == p2);
+
+    /* rounded down to the qty increment on the last maker only */
+    CHECK(cb[5].type == Book::TypedCallback::cb_trade);
+    CHECK(cb[5].qty == doctest::Approx(0.1234567).epsilon(1e-12));
+    CHECK(cb[5].price == p2);
+
+    CHECK(cb[0].qty * cb[0].avg_price <= f);
+    CHECK(f - cb[0].qty * cb[0].avg_price < p2 * book::TRADE_QTY_INCREMENT);
+
+    /* funds left are below MIN_ORDER_FUNDS */
+    CHECK(cb[6].type == Book::TypedCallback::cb_book_update);
+    CHECK(book.asks().size() == 1);
+  }
+
+
+  SUBCASE("market buy by funds rounding over several makers at a level") {
+    const double p1 = 3038.0;
+    const double f = 24964.764999999996;
+
+    for(double qty : { 0.8, 1.8, 2.7, 0.1, 2.8175 })
+      book.add_and_get_cbs(std::make_shared<Order>(USER_1, SELL, p1, qty, 0));
+
+    Book::Callbacks cb;
+    REQUIRE_NOTHROW(cb = book.add_and_get_cbs(std::make_shared<Order>(USER_2, BUY, 0, 0, f)));
+
+    REQUIRE(cb.size() == 7);
+    CHECK(cb[4].qty == 0.1);
+
+    /* the last maker gets what the funds left can buy */
+    CHECK(cb[5].type == Book::TypedCallback::cb_trade);
+    CHECK(cb[5].qty < 2.8175);
+    CHECK(f - cb[0].qty * cb[0].avg_price < p1 * book::TRADE_QTY_INCREMENT);
+  }
+
+  SUBCASE("market buys by funds never overspend") {
+    struct Level { double price; double funds; std::vector<double> qty; };
+
+    /* funds of the qty of the whole level, rounded */
+    const Level levels[] = {
+      { 3750.97, 31253.082039999994, { 3.1333, 3.3386, 1.6502, 0.0732, 0.1367 } },
+      { 1200.0, 17089.919999999998, { 2.3255, 1.4846, 3.8801, 0.2001, 3.3874, 2.9639 } },
+      { 70.74, 970.30520999999987, { 2.9473, 3.6313, 0.6617, 3.7279, 2.7483 } },
+      { 1678.22, 3954.72543, { 0.4187, 1.9378 } },
+      { 1058.93, 6759.0442969999995, { 2.7154, 3.6675 } }
+    };
+
+    for(auto& level : levels) {
+      Book level_book(SYMBOL_ID_1);
+      for(double qty : level.qty)
+        level_book.add(std::make_shared<Order>(USER_1, SELL, level.price, qty, 0));
+
+      Book::Callbacks cb;
+      REQUIRE_NOTHROW(cb = level_book.add_and_get_cbs(
+        std::make_shared<Order>(USER_2, BUY, 0, 0, level.funds)));
+
+      CHECK(cb[0].qty * cb[0].avg_price <= doctest::Approx(level.funds));
+      CHECK(cb[0].qty > 0);
+    }
+  }
+
+
   SUBCASE("limit buy against limit sell") {
     const double p1 = 1000.00;
 
@@ -242,4 +317,145 @@ TEST_CASE("matching") {
 
 }
 
-}
\ No newline at end of file
+
+class TestDepthBook : public depth::DepthBook<OrderPtr, 5> {
+public:
+  TestDepthBook() : depth::DepthBook<OrderPtr, 5>({ 1, 10, 100, 1000 }) {}
+
+  void add(double price, double qty, bool is_bid) {
+    depth_.add_order(price, qty, is_bid);
+  }
+
+  void on_depth_change() {}
+  void on_bbo_change() {}
+};
+
+
+/* no plugin, nothing vetoes filling makers a level at a time */
+typedef book::ComposeTracker<OrderPtr> PlainTracker;
+typedef fixtures::ME<PlainTracker> PlainBook;
+
+TEST_CASE("level fills") {
+  PlainBook book(SYMBOL_ID_1);
+
+  const double p1 = 1000.00;
+  const double p2 = 1001.00;
+
+  std::vector<OrderPtr> makers = {
+    std::make_shared<Order>(USER_1, SELL, p1, 1.0, 0),
+    std::make_shared<Order>(USER_1, SELL, p1, 2.0, 0),
+    std::make_shared<Order>(USER_1, SELL, p1, 1.5, 0),
+    std::make_shared<Order>(USER_1, SELL, p2, 1.0, 0)
+  };
+
+  for(auto& maker : makers) book.add(maker);
+
+  SUBCASE("a sweep fills a whole level with one callback") {
+    PlainBook::Callbacks cb = book.add_and_get_cbs(
+      std::make_shared<Order>(USER_2, BUY, p2, 5.0, 0));
+
+    REQUIRE(cb.size() == 4);
+    CHECK(cb[0].type == PlainBook::TypedCallback::cb_order_accept);
+    CHECK(cb[0].qty == 5.0);
+
+    CHECK(cb[1].type == PlainBook::TypedCallback::cb_level_fill);
+    CHECK(cb[1].qty == 4.5);
+    CHECK(cb[1].price == p1);
+    CHECK(cb[1].generic_2 == 4.5);
+    CHECK(cb[1].flags == PlainBook::TypedCallback::maker_filled);
+    CHECK(cb[1].fills_begin == 0);
+    CHECK(cb[1].fills_count == 3);
+
+    auto& fills = book.last_maker_fills();
+    REQUIRE(fills.size() == 3);
+    for(size_t i = 0; i < 3; ++i) {
+      CHECK(fills[i].maker == makers[i]);
+      CHECK(fills[i].qty == makers[i]->qty());
+    }
+
+    /* a lone maker at the next level trades the usual way */
+    CHECK(cb[2].type == PlainBook::TypedCallback::cb_trade);
+    CHECK(cb[2].qty == 0.5);
+    CHECK(cb[2].price == p2);
+    CHECK(cb[2].avg_price == doctest::Approx((4.5 * p1 + 0.5 * p2) / 5));
+
+    CHECK(cb[3].type == PlainBook::TypedCallback::cb_book_update);
+    CHECK(book.market_price() == p2);
+    CHECK(book.asks().size() == 1);
+  }
+
+  SUBCASE("a maker the taker can't fill entirely is traded on its own") {
+    PlainBook::Callbacks cb = book.add_and_get_cbs(
+      std::make_shared<Order>(USER_2, BUY, p1, 3.5, 0));
+
+    REQUIRE(cb.size() == 4);
+    CHECK(cb[1].type == PlainBook::TypedCallback::cb_level_fill);
+    CHECK(cb[1].qty == 3.0);
+    CHECK(cb[1].fills_count == 2);
+
+    CHECK(cb[2].type == PlainBook::TypedCallback::cb_trade);
+    CHECK(cb[2].qty == 0.5);
+    CHECK(cb[2].maker_order == makers[2]);
+    CHECK(cb[2].flags == PlainBook::TypedCallback::taker_filled);
+
+    CHECK(book.asks().size() == 2);
+    CHECK(book.asks().begin()->second.open_qty() == 1.0);
+  }
+
+  SUBCASE("depth sees the makers of a level fill") {
+    TestDepthBook depth;
+    for(auto& maker : makers)
+      depth.add(maker->price(), maker->qty(), maker->is_bid());
+
+    PlainBook::Callbacks cb = book.add_and_get_cbs(
+      std::make_shared<Order>(USER_2, BUY, 0, 4.5, 0));
+
+    REQUIRE(cb[1].type == PlainBook::TypedCallback::cb_level_fill);
+    depth.on_level_fill(cb[1].order, &book.last_maker_fills()[cb[1].fills_begin],
+      cb[1].fills_count, cb[1].qty, cb[1].flags & PlainBook::TypedCallback::taker_filled);
+
+    const depth::DepthLevel* asks = depth.get_depth().asks();
+    CHECK(asks[0].price() == p2);
+    CHECK(asks[0].aggregate_qty() == 1.0);
+    CHECK(asks[0].order_count() == 1);
+  }
+
+  SUBCASE("funds-limited level fills never overspend") {
+    struct Level { double price; double funds; std::vector<double> qty; };
+
+    /* funds of the qty of the whole level, rounded */
+    const Level levels[] = {
+      { 3750.97, 31253.082039999994, { 3.1333, 3.3386, 1.6502, 0.0732, 0.1367 } },
+      { 1058.93, 6759.0442969999995, { 2.7154, 3.6675 } },
+      { 4749.75, 18002.027474999999, { 2.1338, 1.6563 } }
+    };
+
+    for(auto& level : levels) {
+      PlainBook level_book(SYMBOL_ID_1);
+      for(double qty : level.qty)
+        level_book.add(std::make_shared<Order>(USER_1, SELL, level.price, qty, 0));
+
+      PlainBook::Callbacks cb;
+      REQUIRE_NOTHROW(cb = level_book.add_and_get_cbs(
+        std::make_shared<Order>(USER_2, BUY, 0, 0, level.funds)));
+
+      CHECK(cb[0].qty * cb[0].avg_price <= doctest::Approx(level.funds));
+      CHECK(cb[0].qty > 0);
+    }
+  }
+
+  SUBCASE("a vetoing plugin gets a callback per maker") {
+    Book stp_book(SYMBOL_ID_1);
+    for(auto& maker : makers)
+      stp_book.add(std::make_shared<Order>(USER_1, SELL, maker->price(), maker->qty(), 0));
+
+    Book::Callbacks cb = stp_book.add_and_get_cbs(
+      std::make_shared<Order>(USER_2, BUY, p1, 4.5, 0));
+
+    REQUIRE(cb.size() == 5);
+    for(size_t i = 1; i < 4; ++i)
+      CHECK(cb[i].type == Book::TypedCallback::cb_trade);
+  }
+}
+
+}
@@ -19,14 +19,8 @@
 typedef fixtures::OrderWithUserID Order;
 typedef std::shared_ptr<Order> OrderPtr;
 
-struct Tracker :
-  public virtual book::BaseTracker<OrderPtr>,
-  public book::plugins::PositionsTracker<OrderPtr>
-{
-  Tracker(const OrderPtr& order) :
-    book::BaseTracker<OrderPtr>(order),
-    book::plugins::PositionsTracker<OrderPtr>(order) {}
-};
+typedef book::ComposeTracker<OrderPtr,
+  book::plugins::PositionsTracker> Tracker;
 
 typedef fixtures::ME<
   Tracker,
@@ -163,4 +157,51 @@ TEST_CASE("positions") {
     }
   }
 
-}
\ No newline at end of file
+}
+
+TEST_CASE("position store") {
+  book::plugins::PositionStore store(4);
+
+  SUBCASE("slots are stable and found by user id") {
+    for(uint64_t user_id = 1; user_id <= 1000; ++user_id)
+      store.at(store.acquire(user_id)).qty = user_id;
+
+    CHECK(store.size() == 1000);
+
+    for(uint64_t user_id = 1; user_id <= 1000; ++user_id) {
+      uint32_t slot = store.find(user_id);
+      REQUIRE(slot != book::plugins::PositionStore::npos);
+      CHECK(store.at(slot).qty == user_id);
+      CHECK(store.acquire(user_id) == slot);
+    }
+
+    CHECK(store.find(1001) == book::plugins::PositionStore::npos);
+  }
+
+  SUBCASE("released positions are reclaimed") {
+    for(uint64_t user_id = 1; user_id <= 1000; ++user_id)
+      store.at(store.acquire(user_id)).qty = user_id;
+
+    /* release every odd user, the even ones must still be reachable */
+    for(uint64_t user_id = 1; user_id <= 1000; user_id += 2)
+      store.release(user_id);
+
+    CHECK(store.size() == 500);
+
+    for(uint64_t user_id = 1; user_id <= 1000; ++user_id) {
+      uint32_t slot = store.find(user_id);
+
+      if(user_id % 2) {
+        CHECK(slot == book::plugins::PositionStore::npos);
+      } else {
+        REQUIRE(slot != book::plugins::PositionStore::npos);
+        CHECK(store.at(slot).qty == user_id);
+      }
+    }
+
+    /* recycled slots come back flat */
+    uint32_t slot = store.acquire(5000);
+    CHECK(slot < 1000);
+    CHECK(store.at(slot).qty == 0);
+  }
+}
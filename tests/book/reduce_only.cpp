@@ -23,16 +23,9 @@ namespace reduce_only_test {
 typedef fixtures::OrderWithReduceOnly Order;
 typedef std::shared_ptr<Order> OrderPtr;
 
-struct Tracker :
-  public virtual book::BaseTracker<OrderPtr>,
-  public book::plugins::PositionsTracker<OrderPtr>,
-  public book::plugins::ReduceOnlyTracker<OrderPtr>
-{
-  Tracker(const OrderPtr& order) :
-    book::BaseTracker<OrderPtr>(order),
-    book::plugins::PositionsTracker<OrderPtr>(order),
-    book::plugins::ReduceOnlyTracker<OrderPtr>(order) {}
-};
+typedef book::ComposeTracker<OrderPtr,
+  book::plugins::PositionsTracker,
+  book::plugins::ReduceOnlyTracker> Tracker;
 
 typedef fixtures::ME<
   Tracker,
@@ -98,6 +91,54 @@ TEST_CASE("reduce-only") {
       CHECK(cb[5].type == Book::TypedCallback::cb_book_update);
     }
 
+    SUBCASE("amending a reduce-only order past the position should be rejected") {
+      auto order = std::make_shared<Order>(USER_1, BUY, price / 2, qty, 0, true);
+      book.add(order);
+
+      book.start_recording_callbacks();
+      book.amend(order, std::make_shared<Order>(USER_1, BUY, price / 2 + 1, qty2, 0, true));
+
+      Book::Callbacks cb = book.get_recorded_callbacks();
+      REQUIRE(cb.size() == 1);
+      CHECK(cb[0].type == Book::TypedCallback::cb_order_replace_reject);
+      CHECK(cb[0].reason == book::replace_reject_not_allowed);
+      CHECK(book.bids().begin()->second.ptr() == order);
+
+      auto amended = std::make_shared<Order>(USER_1, BUY, price / 2 + 1, qty / 2, 0, true);
+      book.amend(order, amended);
+
+      REQUIRE(book.bids().size() == 1);
+      CHECK(book.bids().begin()->second.ptr() == amended);
+    }
+
+    SUBCASE("closing the position cancels only the reduce-only orders still on the book") {
+      auto order1 = std::make_shared<Order>(USER_1, BUY, price, qty/2, 0, true);
+      auto order2 = std::make_shared<Order>(USER_1, BUY, price, qty/2, 0, true);
+      auto order3 = std::make_shared<Order>(USER_1, BUY, price, qty/4, 0, true);
+
+      book.add_and_get_cbs(order1);
+      book.add_and_get_cbs(order2);
+      book.add_and_get_cbs(order3);
+      book.cancel(order2, book::user_cancel);
+
+      CHECK(book.bids().size() == 2);
+
+      book.add_and_get_cbs(std::make_shared<Order>(USER_2, SELL, price2, qty, 0));
+      Book::Callbacks cb = book.add_and_get_cbs(std::make_shared<Order>(USER_1, BUY, 0, qty, 0));
+
+      CHECK(cb.size() == 7);
+      CHECK(cb[2].type == Book::TypedCallback::cb_position_close);
+      CHECK(cb[3].type == Book::TypedCallback::cb_position_close);
+      CHECK(cb[4].type == Book::TypedCallback::cb_order_cancel);
+      CHECK(cb[4].reason == book::CancelReasons::reduce_only_close);
+      CHECK(cb[4].order == order3);
+      CHECK(cb[5].type == Book::TypedCallback::cb_order_cancel);
+      CHECK(cb[5].order == order1);
+      CHECK(cb[6].type == Book::TypedCallback::cb_book_update);
+
+      CHECK(book.bids().size() == 0);
+    }
+
     SUBCASE("closing the position, having a pending reduce-only. should replace the reduce-only") {
 
       GIVEN("a reduce-only order that will trade later") {
@@ -4,6 +4,7 @@
 #include <stack>
 
 #include <utils/symbols.h>
+#include <utils/sequence_id.h>
 #include <book/tracker.h>
 #include <book/plugins/routable.h>
 #include <book/plugins/self_trade_policy.h>
@@ -29,16 +30,9 @@ using namespace utils;
 typedef fixtures::OrderWithUserID Order;
 typedef std::shared_ptr<Order> OrderPtr;
 
-struct Tracker :
-  public virtual book::BaseTracker<OrderPtr>,
-  public book::plugins::SelfTradePolicyTracker<OrderPtr>,
-  public book::plugins::RoutableTracker<OrderPtr>
-{
-  Tracker(const OrderPtr& order) :
-    book::BaseTracker<OrderPtr>(order),
-    book::plugins::SelfTradePolicyTracker<OrderPtr>(order),
-    book::plugins::RoutableTracker<OrderPtr>(order) {}
-};
+typedef book::ComposeTracker<OrderPtr,
+  book::plugins::SelfTradePolicyTracker,
+  book::plugins::RoutableTracker> Tracker;
 
 
 typedef fixtures::ME<
@@ -50,6 +44,7 @@ typedef fixtures::ME<
 enum RoutingScenario {
   ROUTING_SUCCESS,
   ROUTING_FAILURE,
+  ROUTING_FAILURE_ON_MM2_EXCHANGE,
   ROUTING_NO_RESPONSE
 };
 
@@ -79,6 +74,9 @@ public:
 
   RoutingScenario routing_scenario;
 
+  using Book_::on_routing_success;
+  using Book_::on_routing_failure;
+
 protected:
   void on_routing_request(const RoutingRequest& request) {
     routing_requests_.push(request);
@@ -87,6 +85,12 @@ protected:
       on_routing_success(request.request_id);
     else if(routing_scenario == ROUTING_FAILURE)
       on_routing_failure(request.request_id);
+    else if(routing_scenario == ROUTING_FAILURE_ON_MM2_EXCHANGE) {
+      if(request.exchange_id == MM2_EXCHANGE)
+        on_routing_failure(request.request_id);
+      else
+        on_routing_success(request.request_id);
+    }
   };
 
 private:
@@ -173,6 +177,8 @@ TEST_CASE("routable orders") {
 
       CHECK(cb[3].type == Book::TypedCallback::cb_book_update);
 
+      /* the request is released once routed */
+      CHECK(book.pending_requests_size() == 0);
 
       /* check the routing request */
 
@@ -213,6 +219,7 @@ TEST_CASE("routable orders") {
 
       CHECK(cb[4].type == Book::TypedCallback::cb_book_update);
 
+      CHECK(book.pending_requests_size() == 1);
 
       /* check the routing request */
 
@@ -487,6 +494,11 @@ TEST_CASE("routable orders") {
       CHECK(r2.price == 1422.00);
       CHECK(r2.cancel_reason == book::dont_cancel);
 
+      /* sequence ids, unique and increasing within the book */
+      CHECK(seq_id_symbol(r1.request_id) == SYMBOL_ID_1);
+      CHECK(seq_id_symbol(r2.request_id) == SYMBOL_ID_1);
+      CHECK(r2.request_id > r1.request_id);
+
       CHECK(book.bids().size() == 0);
       CHECK(book.asks().size() == 0);
     }
@@ -716,38 +728,29 @@ TEST_CASE("routable orders") {
       book.add_and_get_cbs(order3);
       Book::Callbacks cb = book.get_recorded_callbacks();
 
-      CHECK(cb.size() == 8);
+      CHECK(cb.size() == 6);
       CHECK(cb[0].type == Book::TypedCallback::cb_order_accept);
 
-      /* routinig order 1 */
-      
+      /* both orders are matched in one go, one leg per exchange */
       CHECK(cb[1].type == Book::TypedCallback::cb_trade);
       CHECK(cb[1].scope == Book::TypedCallback::CbScope::internal_only);
       CHECK(cb[1].order->order_id() == order3->order_id());
       CHECK(cb[1].maker_order->order_id() == order1->order_id());
 
-      /* then we hit a different exchange mm order,
-        this cancel is made by should_trade then suppressed */
-      CHECK(cb[2].type == Book::TypedCallback::cb_order_cancel);
-      CHECK(cb[2].order->order_id() == order3->order_id());
+      CHECK(cb[2].type == Book::TypedCallback::cb_trade);
+      CHECK(cb[2].scope == Book::TypedCallback::CbScope::internal_only);
+      CHECK(cb[2].maker_order->order_id() == order2->order_id());
 
-      /* routing success for order 1 */
+      /* routing success for both legs, fills replayed in price-time order */
       CHECK(cb[3].type == Book::TypedCallback::cb_trade);
       CHECK(cb[3].scope == Book::TypedCallback::CbScope::external_only);
       CHECK(cb[3].maker_order->order_id() == order1->order_id());
 
-      /* now we match with mm2 order*/
       CHECK(cb[4].type == Book::TypedCallback::cb_trade);
-      CHECK(cb[4].scope == Book::TypedCallback::CbScope::internal_only);
+      CHECK(cb[4].scope == Book::TypedCallback::CbScope::external_only);
       CHECK(cb[4].maker_order->order_id() == order2->order_id());
 
-      /* routing success for order 2 */
-      CHECK(cb[5].type == Book::TypedCallback::cb_trade);
-      CHECK(cb[5].scope == Book::TypedCallback::CbScope::external_only);
-      CHECK(cb[5].maker_order->order_id() == order2->order_id());
-
-      CHECK(cb[6].type == Book::TypedCallback::cb_order_accept);
-      CHECK(cb[7].type == Book::TypedCallback::cb_book_update);
+      CHECK(cb[5].type == Book::TypedCallback::cb_book_update);
 
       CHECK(book.routing_requests_size() == 2);
       auto& r2 = book.pop_routing_request();
@@ -767,6 +770,9 @@ TEST_CASE("routable orders") {
       CHECK(r2.price == 2000.00);
       CHECK(r2.cancel_reason == book::dont_cancel);
 
+      CHECK(r2.request_id > r1.request_id);
+      CHECK(book.pending_requests_size() == 0);
+
       CHECK(book.bids().size() == 0);
       CHECK(book.asks().size() == 0);
     }
@@ -783,30 +789,85 @@ TEST_CASE("routable orders") {
       CHECK(cb.size() == 5);
       CHECK(cb[0].type == Book::TypedCallback::cb_order_accept);
 
-      /* routinig order 1 */
-      
       CHECK(cb[1].type == Book::TypedCallback::cb_trade);
-      CHECK(cb[1].scope == Book::TypedCallback::CbScope::internal_only);
-      CHECK(cb[1].order->order_id() == order3->order_id());
       CHECK(cb[1].maker_order->order_id() == order1->order_id());
+      CHECK(cb[2].type == Book::TypedCallback::cb_trade);
+      CHECK(cb[2].maker_order->order_id() == order2->order_id());
 
-      /* then we hit a different exchange mm order,
-        this cancel is made by should_trade then suppressed */
-      CHECK(cb[2].type == Book::TypedCallback::cb_order_cancel);
-      CHECK(cb[2].order->order_id() == order3->order_id());
-
-      /* routing failure for order 1 */
+      /* both legs failed, nothing is filled */
       CHECK(cb[3].type == Book::TypedCallback::cb_order_cancel);
       CHECK(cb[3].scope == Book::TypedCallback::CbScope::external_only);
+      CHECK(cb[3].reason == book::CancelReasons::routing_failure);
+      CHECK(cb[3].order->order_id() == order3->order_id());
+      CHECK(cb[3].generic_1 == 2.0);
 
-      /* stop here. never reaching order 2 */
       CHECK(cb[4].type == Book::TypedCallback::cb_book_update);
 
-      
-      CHECK(book.routing_requests_size() == 1);
+      CHECK(book.routing_requests_size() == 2);
+      CHECK(book.pending_requests_size() == 0);
 
       CHECK(book.bids().size() == 0);
-      CHECK(book.asks().size() == 1);
+      CHECK(book.asks().size() == 0);
+    }
+
+    SUBCASE("adding a user order fully matching the two MM orders, one leg fails") {
+      book.routing_scenario = ROUTING_FAILURE_ON_MM2_EXCHANGE;
+
+      auto order3 = std::make_shared<Order>(USER_1, BUY, 2000.00, 2.0, 0.0);
+      order3->order_id((uint128){1, 3});
+      book.start_recording_callbacks();
+      book.add_and_get_cbs(order3);
+      Book::Callbacks cb = book.get_recorded_callbacks();
+
+      CHECK(cb.size() == 6);
+      CHECK(cb[0].type == Book::TypedCallback::cb_order_accept);
+
+      /* only the fill of the successful leg is replayed */
+      CHECK(cb[3].type == Book::TypedCallback::cb_trade);
+      CHECK(cb[3].scope == Book::TypedCallback::CbScope::external_only);
+      CHECK(cb[3].maker_order->order_id() == order1->order_id());
+
+      /* the qty of the failed leg is cancelled */
+      CHECK(cb[4].type == Book::TypedCallback::cb_order_cancel);
+      CHECK(cb[4].scope == Book::TypedCallback::CbScope::external_only);
+      CHECK(cb[4].reason == book::CancelReasons::routing_failure);
+      CHECK(cb[4].generic_1 == 1.0);
+
+      CHECK(cb[5].type == Book::TypedCallback::cb_book_update);
+
+      CHECK(book.routing_requests_size() == 2);
+      CHECK(book.pending_requests_size() == 0);
+    }
+
+    SUBCASE("adding a user order, responses arriving out of order") {
+      book.routing_scenario = ROUTING_NO_RESPONSE;
+
+      auto order3 = std::make_shared<Order>(USER_1, BUY, 2000.00, 2.0, 0.0);
+      order3->order_id((uint128){1, 3});
+      book.add_and_get_cbs(order3);
+
+      CHECK(book.routing_requests_size() == 2);
+      CHECK(book.pending_requests_size() == 2);
+
+      auto& r2 = book.pop_routing_request();
+      auto& r1 = book.pop_routing_request();
+
+      book.start_recording_callbacks();
+      book.on_routing_success(r2.request_id);
+
+      /* waiting for the other leg */
+      CHECK(book.get_recorded_callbacks().size() == 0);
+
+      book.on_routing_success(r1.request_id);
+      Book::Callbacks cb = book.get_recorded_callbacks();
+
+      CHECK(cb.size() == 2);
+      CHECK(cb[0].type == Book::TypedCallback::cb_trade);
+      CHECK(cb[0].maker_order->order_id() == order1->order_id());
+      CHECK(cb[1].type == Book::TypedCallback::cb_trade);
+      CHECK(cb[1].maker_order->order_id() == order2->order_id());
+
+      CHECK(book.pending_requests_size() == 0);
     }
   }
 
@@ -21,14 +21,8 @@ typedef fixtures::OrderWithUserID Order;
 typedef std::shared_ptr<Order> OrderPtr;
 
 
-struct Tracker :
-  public virtual book::BaseTracker<OrderPtr>,
-  public book::plugins::SelfTradePolicyTracker<OrderPtr>
-{
-  Tracker(const OrderPtr& order) :
-    book::BaseTracker<OrderPtr>(order),
-    book::plugins::SelfTradePolicyTracker<OrderPtr>(order) {}
-};
+typedef book::ComposeTracker<OrderPtr,
+  book::plugins::SelfTradePolicyTracker> Tracker;
 
 
 typedef fixtures::ME<
@@ -0,0 +1,30 @@
+#include <doctest/doctest.h>
+#include <stdexcept>
+
+#include <utils/sequence_id.h>
+
+namespace sequence_id_test {
+
+using namespace utils;
+
+TEST_CASE("sequence ids") {
+  SUBCASE("fields round-trip") {
+    uint64_t id = make_seq_id((uint32_t)SEQ_ID_SYMBOL_MASK, 7, SEQ_ID_SEQUENCE_MASK);
+    CHECK(seq_id_symbol(id) == SEQ_ID_SYMBOL_MASK);
+    CHECK(seq_id_shard(id) == 7);
+    CHECK(seq_id_sequence(id) == SEQ_ID_SEQUENCE_MASK);
+
+    CHECK(make_seq_id(3, 0, 1) < make_seq_id(3, 0, 2));
+  }
+
+  SUBCASE("fields that don't fit are rejected") {
+    /* would be the id of symbol 0 */
+    CHECK_THROWS_AS(make_seq_id((uint32_t)SEQ_ID_SYMBOL_MASK + 1, 0, 1), std::out_of_range);
+    CHECK_THROWS_AS(make_seq_id(1, (uint32_t)SEQ_ID_SHARD_MASK + 1, 1), std::out_of_range);
+
+    /* would wrap to an id already given */
+    CHECK_THROWS_AS(make_seq_id(1, 0, SEQ_ID_SEQUENCE_MASK + 1), std::overflow_error);
+  }
+}
+
+}
@@ -0,0 +1,147 @@
+#include <doctest/doctest.h>
+#include <memory>
+#include <atomic>
+#include <thread>
+
+#include <book/types.h>
+#include <book/plugins/snapshots.h>
+#include "fixtures/order.h"
+#include "fixtures/me.h"
+
+#define SYMBOL_ID_1 1
+#define USER_1 1
+#define USER_2 2
+
+#define BUY true
+#define SELL false
+
+namespace snapshots_test {
+
+typedef fixtures::OrderWithUserID Order;
+typedef std::shared_ptr<Order> OrderPtr;
+
+typedef book::ComposeTracker<OrderPtr> Tracker;
+
+typedef fixtures::ME<
+  Tracker,
+  book::plugins::SnapshotPlugin<Tracker>
+> Book;
+
+typedef Book::SnapshotPtr SnapshotPtr;
+
+
+TEST_CASE("snapshots") {
+  Book book(SYMBOL_ID_1);
+
+  CHECK(book.snapshot()->version == 0);
+  CHECK(book.publish_snapshot() == 0);
+
+  auto bid_1 = std::make_shared<Order>(USER_1, BUY, 1000, 1.0, 0);
+  auto bid_2 = std::make_shared<Order>(USER_2, BUY, 1000, 2.0, 0);
+  auto bid_3 = std::make_shared<Order>(USER_1, BUY, 999, 1.0, 0);
+  auto ask_1 = std::make_shared<Order>(USER_2, SELL, 1010, 3.0, 0);
+
+  book.add(bid_1);
+  book.add(bid_2);
+  book.add(bid_3);
+  book.add(ask_1);
+
+  CHECK(book.publish_snapshot() == 1);
+  SnapshotPtr first = book.snapshot();
+
+  CHECK(first->symbol_id == SYMBOL_ID_1);
+  REQUIRE(first->bids.size() == 2);
+  REQUIRE(first->asks.size() == 1);
+  CHECK(first->bids[0]->price == 1000);
+  CHECK(first->bids[0]->qty == 3.0);
+  CHECK(first->bids[0]->orders.size() == 2);
+  CHECK(first->bids[0]->orders[0].order == bid_1);
+  CHECK(first->bids[1]->price == 999);
+  CHECK(first->level(false, 1010)->qty == 3.0);
+  CHECK(first->level(false, 1011) == nullptr);
+  CHECK(first->find(bid_2)->open_qty == 2.0);
+
+  SUBCASE("nothing is published unless the book changed") {
+    CHECK(book.publish_snapshot() == 1);
+    CHECK(book.snapshot() == first);
+  }
+
+  SUBCASE("unchanged levels are shared") {
+    book.add(std::make_shared<Order>(USER_1, SELL, 1000, 1.5, 0));
+    CHECK(book.publish_snapshot() == 2);
+
+    SnapshotPtr second = book.snapshot();
+    CHECK(second->market_price == 1000);
+    CHECK(second->bids[0] != first->bids[0]);
+    CHECK(second->bids[1] == first->bids[1]);
+    CHECK(second->asks[0] == first->asks[0]);
+
+    CHECK(second->bids[0]->qty == 1.5);
+    CHECK(second->find(bid_1) == nullptr);
+    CHECK(second->find(bid_2)->filled_qty == 0.5);
+
+    /* the first snapshot is untouched */
+    CHECK(first->bids[0]->qty == 3.0);
+    CHECK(first->find(bid_1)->open_qty == 1.0);
+  }
+
+  SUBCASE("cancels, replaces and halts") {
+    book.cancel(bid_3, book::user_cancel);
+    book.replace(ask_1, -1.0);
+    CHECK(book.publish_snapshot() == 2);
+
+    SnapshotPtr second = book.snapshot();
+    CHECK(second->bids.size() == 1);
+    CHECK(second->find(bid_3) == nullptr);
+    CHECK(second->asks[0]->qty == 2.0);
+
+    book.halt();
+    book.resume();
+    book.add(std::make_shared<Order>(USER_1, BUY, 990, 1.0, 0));
+    CHECK(book.publish_snapshot() == 3);
+
+    SnapshotPtr third = book.snapshot();
+    REQUIRE(third->bids.size() == 1);
+    CHECK(third->bids[0]->price == 990);
+    CHECK(third->asks.empty());
+  }
+
+  SUBCASE("readers query while matching goes on") {
+    std::atomic<bool> done(false);
+    bool consistent = true;
+
+    /* every snapshot must have an uncrossed book with consistent levels */
+    std::thread reader([&]() {
+      uint64_t last = 0;
+
+      while(!done) {
+        SnapshotPtr snapshot = book.snapshot();
+        consistent &= snapshot->version >= last;
+        last = snapshot->version;
+
+        if(!snapshot->bids.empty() && !snapshot->asks.empty())
+          consistent &= snapshot->bids[0]->price < snapshot->asks[0]->price;
+
+        for(auto& level : snapshot->bids) {
+          double qty = 0;
+          for(auto& entry : level->orders) qty += entry.open_qty;
+          consistent &= qty == level->qty;
+        }
+      }
+    });
+
+    for(int i = 0; i < 2000; ++i) {
+      book.add(std::make_shared<Order>(USER_1, BUY, 990 + i % 10, 1.0, 0));
+      book.add(std::make_shared<Order>(USER_2, SELL, 995 + i % 10, 1.0, 0));
+      book.publish_snapshot();
+    }
+
+    done = true;
+    reader.join();
+
+    CHECK(consistent);
+    CHECK(book.snapshot()->version > 1);
+  }
+}
+
+}
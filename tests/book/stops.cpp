@@ -10,11 +10,12 @@
 #include "fixtures/me.h"
 #include "fixtures/helpers.h"
 
-namespace matching_test {
+namespace stops_test {
 
 #define SYMBOL_ID_1 1
 #define USER_1 1
 #define USER_2 2
+#define USER_3 3
 
 #define BUY true
 #define SELL false
@@ -23,12 +24,7 @@ typedef fixtures::OrderWithStopPrice Order;
 typedef std::shared_ptr<Order> OrderPtr;
 
 
-struct Tracker :
-  public virtual book::BaseTracker<OrderPtr>
-{
-  Tracker(const OrderPtr& order) :
-    book::BaseTracker<OrderPtr>(order) {}
-};
+typedef book::ComposeTracker<OrderPtr> Tracker;
 
 
 typedef fixtures::ME<
@@ -36,9 +32,131 @@ typedef fixtures::ME<
   book::plugins::StopOrdersPlugin<Tracker>
 > Book;
 
+/* sets the market price by crossing two orders at `price` */
+size_t trade_at(Book& book, double price) {
+  book.start_recording_callbacks();
+  book.add_and_get_cbs(std::make_shared<Order>(USER_1, SELL, price, 1.0, 0));
+  book.add_and_get_cbs(std::make_shared<Order>(USER_2, BUY, price, 1.0, 0));
+  Book::Callbacks cb = book.get_recorded_callbacks();
 
-TEST_CASE("adding orders") {
+  size_t triggered = 0;
+  for(auto& c : cb)
+    if(c.type == Book::TypedCallback::cb_order_stop_trigger) ++triggered;
 
+  return triggered;
 }
 
-}
\ No newline at end of file
+OrderPtr stop(bool is_bid, double stop_price) {
+  /* limit prices far from the market so that triggered orders rest */
+  return std::make_shared<Order>(USER_3, is_bid, is_bid ? 1 : 100000, 1.0, 0, stop_price);
+}
+
+OrderPtr trailing_stop(bool is_bid, book::plugins::TrailingType type, double offset) {
+  return std::make_shared<Order>(USER_3, is_bid, is_bid ? 1 : 100000, 1.0, 0, 0, type, offset);
+}
+
+
+TEST_CASE("stop orders") {
+  Book book(SYMBOL_ID_1);
+  trade_at(book, 1000);
+
+  SUBCASE("stop orders are not added to the book") {
+    Book::Callbacks cb = book.add_and_get_cbs(stop(BUY, 1100));
+
+    CHECK(cb.size() == 2);
+    CHECK(cb[0].type == Book::TypedCallback::cb_order_accept);
+    CHECK(cb[1].type == Book::TypedCallback::cb_book_update);
+    CHECK(book.bids().size() == 0);
+  }
+
+  SUBCASE("buy stops trigger in order of stop price") {
+    book.add_and_get_cbs(stop(BUY, 1100));
+    book.add_and_get_cbs(stop(BUY, 1050));
+
+    CHECK(trade_at(book, 1020) == 0);
+    CHECK(trade_at(book, 1075) == 1);
+    CHECK(book.bids().size() == 1);
+    CHECK(trade_at(book, 1100) == 1);
+    CHECK(book.bids().size() == 2);
+  }
+
+  SUBCASE("sell stops trigger in order of stop price") {
+    book.add_and_get_cbs(stop(SELL, 900));
+    book.add_and_get_cbs(stop(SELL, 950));
+
+    CHECK(trade_at(book, 980) == 0);
+    CHECK(trade_at(book, 925) == 1);
+    CHECK(book.asks().size() == 1);
+    CHECK(trade_at(book, 850) == 1);
+    CHECK(book.asks().size() == 2);
+  }
+}
+
+
+TEST_CASE("trailing stop orders") {
+  Book book(SYMBOL_ID_1);
+  trade_at(book, 1000);
+
+  SUBCASE("trailing sell stop follows the high") {
+    book.add_and_get_cbs(trailing_stop(SELL, book::plugins::trail_absolute, 50));
+
+    CHECK(trade_at(book, 960) == 0);
+    CHECK(trade_at(book, 1100) == 0);
+    CHECK(trade_at(book, 1060) == 0);
+    CHECK(trade_at(book, 1050) == 1);
+    CHECK(book.asks().size() == 1);
+  }
+
+  SUBCASE("trailing buy stop follows the low, by percentage") {
+    book.add_and_get_cbs(trailing_stop(BUY, book::plugins::trail_percent, 0.25));
+
+    CHECK(trade_at(book, 1200) == 0);
+    CHECK(trade_at(book, 800) == 0);
+    CHECK(trade_at(book, 999) == 0);
+    CHECK(trade_at(book, 1000) == 1);
+    CHECK(book.bids().size() == 1);
+  }
+
+  SUBCASE("each trailing stop keeps the watermark seen since it was added") {
+    book.add_and_get_cbs(trailing_stop(SELL, book::plugins::trail_absolute, 100));
+
+    trade_at(book, 1200);
+    trade_at(book, 1150);
+
+    /* high is 1200 for the first order, 1150 for the second */
+    book.add_and_get_cbs(trailing_stop(SELL, book::plugins::trail_absolute, 30));
+
+    SUBCASE("without a new high") {
+      CHECK(trade_at(book, 1130) == 0);
+      CHECK(trade_at(book, 1120) == 1);
+      CHECK(trade_at(book, 1101) == 0);
+      CHECK(trade_at(book, 1100) == 1);
+    }
+
+    SUBCASE("a new high is shared by both orders") {
+      CHECK(trade_at(book, 1300) == 0);
+      CHECK(trade_at(book, 1270) == 1);
+      CHECK(trade_at(book, 1201) == 0);
+      CHECK(trade_at(book, 1200) == 1);
+    }
+
+    SUBCASE("both trigger on the same trade") {
+      CHECK(trade_at(book, 1000) == 2);
+      CHECK(book.asks().size() == 2);
+    }
+  }
+
+  SUBCASE("absolute and percentage trailing stops together") {
+    book.add_and_get_cbs(trailing_stop(SELL, book::plugins::trail_percent, 0.125));
+    book.add_and_get_cbs(trailing_stop(SELL, book::plugins::trail_absolute, 100));
+
+    trade_at(book, 1600);
+
+    /* 1400 for the percentage, 1500 for the absolute offset */
+    CHECK(trade_at(book, 1500) == 1);
+    CHECK(trade_at(book, 1401) == 0);
+    CHECK(trade_at(book, 1400) == 1);
+  }
+}
+
+}
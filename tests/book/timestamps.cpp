@@ -0,0 +1,112 @@
+#include <doctest/doctest.h>
+#include <memory>
+#include <chrono>
+#include <thread>
+#include <atomic>
+
+#include <utils/ts.h>
+#include <book/types.h>
+#include "fixtures/order.h"
+#include "fixtures/me.h"
+
+namespace timestamps_test {
+
+typedef fixtures::OrderWithUserID Order;
+typedef std::shared_ptr<Order> OrderPtr;
+
+typedef book::ComposeTracker<OrderPtr> Tracker;
+
+typedef fixtures::ME<Tracker> Book;
+
+TEST_CASE("timestamps") {
+  SUBCASE("ts_ns is monotonic and follows the steady clock") {
+    uint64_t t0 = utils::ts_ns();
+    uint64_t s0 = utils::steady_ns();
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+    uint64_t t1 = utils::ts_ns();
+    uint64_t s1 = utils::steady_ns();
+
+    CHECK(t1 > t0);
+
+    /* loosely: the rate is calibrated over 10ms, on a loaded machine */
+    double ratio = (double)(t1 - t0) / (s1 - s0);
+    CHECK(ratio > 0.8);
+    CHECK(ratio < 1.2);
+  }
+
+  SUBCASE("ticks are scaled in 32.32 fixed point") {
+    utils::TscCalibration c = { 0, 0, 3ull << 31, true }; /* 1.5 ns per tick */
+    CHECK(utils::ticks_to_ns(c, 1000) == 1500);
+    CHECK(utils::ticks_to_ns(c, 1ull << 40) == 3ull << 39);
+  }
+
+  SUBCASE("recalibrating does not move the clock backwards") {
+    uint64_t before = utils::ts_ns();
+    utils::calibrate(1000);
+    CHECK(utils::ts_ns() >= before);
+  }
+
+  SUBCASE("recalibrating while another thread reads the clock") {
+    std::atomic<bool> done(false);
+    std::atomic<bool> steady(true);
+
+    std::thread reader([&]() {
+      uint64_t last = utils::ts_ns();
+      while(!done) {
+        uint64_t now = utils::ts_ns();
+        /* a recalibration may round a few ns off */
+        if(now + 1000 < last) steady = false;
+        last = now;
+      }
+    });
+
+    for(int i = 0; i < 5; ++i) utils::calibrate(1000);
+    done = true;
+    reader.join();
+
+    CHECK(steady);
+  }
+
+  SUBCASE("wall time is the system clock") {
+    uint64_t before = utils::wall_ns() / 1000;
+    uint64_t ts = utils::ts();
+    uint64_t after = utils::wall_ns() / 1000;
+
+    CHECK(ts >= before);
+    CHECK(ts <= after);
+  }
+
+  SUBCASE("timestamps are converted against the system clock") {
+    /* an anchor older than WALL_ANCHOR_NS, off by an hour */
+    utils::anchor_wall();
+    utils::wall_base_ns += 3600000000000ull;
+    utils::wall_anchor_ts -= 2 * utils::WALL_ANCHOR_NS;
+
+    uint64_t before = utils::wall_ns();
+    uint64_t wall = utils::to_wall_ns(utils::ts_ns());
+    uint64_t after = utils::wall_ns();
+
+    /* re-anchored, off by the rounding of the TSC scale at most */
+    CHECK(wall + 1000000 >= before);
+    CHECK(wall <= after + 1000000);
+  }
+
+  SUBCASE("callbacks are stamped when emitted") {
+    Book book(1);
+    uint64_t before = utils::ts_ns();
+
+    book.add_and_get_cbs(std::make_shared<Order>(1, false, 100, 1.0, 0));
+    Book::Callbacks cb = book.add_and_get_cbs(
+      std::make_shared<Order>(2, true, 100, 1.0, 0));
+
+    REQUIRE(cb.size() == 3);
+    CHECK(cb[0].ts >= before);
+    CHECK(cb[1].ts >= cb[0].ts);
+    CHECK(cb[2].ts >= cb[1].ts);
+    CHECK(cb[2].ts <= utils::ts_ns());
+  }
+}
+
+}
@@ -0,0 +1,126 @@
+#include <doctest/doctest.h>
+#include <memory>
+#include <type_traits>
+
+#include <book/tracker.h>
+#include <book/plugins/positions.h>
+#include <book/plugins/reduce_only.h>
+#include <book/plugins/routable.h>
+#include <book/plugins/self_trade_policy.h>
+#include "fixtures/order.h"
+#include "fixtures/me.h"
+
+namespace tracker_test {
+
+using namespace book::plugins;
+
+typedef fixtures::OrderWithReduceOnly Order;
+typedef std::shared_ptr<Order> OrderPtr;
+
+typedef book::ComposeTracker<OrderPtr> Base;
+typedef book::ComposeTracker<OrderPtr, SelfTradePolicyTracker> WithSTP;
+typedef book::ComposeTracker<OrderPtr,
+  SelfTradePolicyTracker, RoutableTracker> WithRouting;
+typedef book::ComposeTracker<OrderPtr,
+  PositionsTracker, ReduceOnlyTracker, SelfTradePolicyTracker> WithReduceOnly;
+
+TEST_CASE("tracker composition") {
+  SUBCASE("trackers have no vtable") {
+    CHECK(!std::is_polymorphic<Base>::value);
+    CHECK(!std::is_polymorphic<WithRouting>::value);
+    CHECK(!std::is_polymorphic<WithReduceOnly>::value);
+  }
+
+  SUBCASE("the user id is stored once") {
+    CHECK(sizeof(WithSTP) == sizeof(Base) + 2 * sizeof(uint64_t));
+    CHECK(sizeof(WithRouting) == sizeof(WithSTP));
+  }
+
+  SUBCASE("mixins read the order once") {
+    auto order = std::make_shared<Order>(7, true, 100, 2.0, 0, true);
+    order->stp(stp_cancel_maker);
+    WithReduceOnly tracker(order);
+
+    CHECK(tracker.is_bid());
+    CHECK(tracker.price() == 100);
+    CHECK(tracker.user_id() == 7);
+    CHECK(tracker.reduce_only());
+    CHECK(tracker.reduce_only_node() == REDUCE_ONLY_NULL_NODE);
+    CHECK(tracker.stp() == stp_cancel_maker);
+  }
+}
+
+
+/* a decoded gateway message, used as an order without a wrapper */
+struct NewOrderMsg {
+  uint128 id;
+  uint32_t user;
+  uint8_t side;
+  double limit_price;
+  double quantity;
+
+  bool is_bid() const { return side == 'B'; }
+  double qty() const { return quantity; }
+  double price() const { return limit_price; }
+  double funds() const { return 0; }
+  uint128 order_id() const { return id; }
+  uint32_t user_id() const { return user; }
+  SelfTradePolicy stp() const { return stp_cancel_taker; }
+};
+
+typedef book::ComposeTracker<const NewOrderMsg*,
+  SelfTradePolicyTracker> MsgTracker;
+
+typedef fixtures::ME<MsgTracker, SelfTradePolicyPlugin<MsgTracker>> MsgBook;
+
+TEST_CASE("plain order structs") {
+  CHECK(book::is_order<const NewOrderMsg*>::value);
+  CHECK(!book::is_order<const uint128*>::value);
+
+  MsgBook book(1);
+  NewOrderMsg sell = { uint128(0, 1), 1, 'S', 100, 2.0 };
+  NewOrderMsg buy = { uint128(0, 2), 2, 'B', 100, 1.0 };
+
+  book.add_and_get_cbs(&sell);
+  MsgBook::Callbacks cb = book.add_and_get_cbs(&buy);
+
+  REQUIRE(cb.size() == 3);
+  CHECK(cb[1].type == MsgBook::TypedCallback::cb_trade);
+  CHECK(cb[1].order == &buy);
+  CHECK(cb[1].maker_order == &sell);
+  CHECK(book.asks().size() == 1);
+  CHECK(book.bids().size() == 0);
+}
+
+
+/* the book itself doesn't identify orders */
+struct AnonymousOrder {
+  bool bid;
+  double limit_price;
+  double quantity;
+
+  bool is_bid() const { return bid; }
+  double qty() const { return quantity; }
+  double price() const { return limit_price; }
+  double funds() const { return 0; }
+};
+
+typedef fixtures::ME<book::ComposeTracker<const AnonymousOrder*>> AnonymousBook;
+
+TEST_CASE("orders without an id") {
+  CHECK(book::is_order<const AnonymousOrder*>::value);
+  CHECK(!book::order_has_order_id<const AnonymousOrder*>::value);
+
+  AnonymousBook book(1);
+  AnonymousOrder sell = { false, 100, 2.0 };
+  AnonymousOrder buy = { true, 100, 1.0 };
+
+  book.add_and_get_cbs(&sell);
+  AnonymousBook::Callbacks cb = book.add_and_get_cbs(&buy);
+
+  REQUIRE(cb.size() == 3);
+  CHECK(cb[1].type == AnonymousBook::TypedCallback::cb_trade);
+  CHECK(cb[1].maker_order == &sell);
+}
+
+}
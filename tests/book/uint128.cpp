@@ -0,0 +1,88 @@
+#include <doctest/doctest.h>
+#include <sstream>
+#include <unordered_set>
+
+#include <utils/uint128.h>
+
+namespace uint128_test {
+
+using namespace utils;
+
+TEST_CASE("uint128") {
+  const uint128 max(UINT64_MAX, UINT64_MAX);
+
+  SUBCASE("arithmetic carries across words") {
+    uint128 a(0, UINT64_MAX);
+    ++a;
+    CHECK(a == uint128(1, 0));
+
+    a -= uint128(0, 1);
+    CHECK(a == uint128(0, UINT64_MAX));
+
+    a += max;
+    CHECK(a == uint128(0, UINT64_MAX - 1));
+  }
+
+  SUBCASE("shifts") {
+    uint128 one(0, 1);
+    CHECK((one << uint128(0, 64)) == uint128(1, 0));
+    CHECK((one << uint128(0, 127)) == uint128(1ull << 63, 0));
+    CHECK((one << uint128(0, 128)) == uint128());
+    CHECK((max >> (uint32_t)68) == uint128(0, UINT64_MAX >> 4));
+    CHECK((max >> uint128(1, 0)) == uint128());
+  }
+
+  SUBCASE("comparisons and bits") {
+    CHECK(uint128(0, 5) < uint128(1, 0));
+    CHECK(uint128(1, 0) > uint128(0, UINT64_MAX));
+    CHECK(uint128(1, 2) >= uint128(1, 2));
+    CHECK(uint128().bits() == 0);
+    CHECK(uint128(0, 1).bits() == 1);
+    CHECK(max.bits() == 128);
+  }
+
+  SUBCASE("divmod") {
+    auto qr = max.divmod(max, uint128(0, 10));
+    CHECK(qr.first == uint128(0x1999999999999999ull, 0x9999999999999999ull));
+    CHECK(qr.second == uint128(0, 5));
+  }
+
+  SUBCASE("decimal formatting") {
+    CHECK(uint128(1, 0).to_string(10, 0) == "18446744073709551616");
+    CHECK(max.to_string(10, 0) == "340282366920938463463374607431768211455");
+    CHECK(uint128(0, 42).to_string(10, 4) == "0042");
+    CHECK(uint128().to_string(2, 0) == "0");
+
+    std::ostringstream os;
+    os << uint128(0, 123);
+    CHECK(os.str() == "00000000000000000000000000000123");
+  }
+
+  SUBCASE("hex and UUID formatting into a caller buffer") {
+    uint128 id(0x0123456789abcdefull, 0xfedcba9876543210ull);
+
+    char hex[uint128::hex_len];
+    CHECK(id.to_hex(hex) == hex + uint128::hex_len);
+    CHECK(std::string(hex, uint128::hex_len) == "0123456789abcdeffedcba9876543210");
+
+    char uuid[uint128::uuid_len];
+    CHECK(id.to_uuid(uuid) == uuid + uint128::uuid_len);
+    CHECK(std::string(uuid, uint128::uuid_len) == "01234567-89ab-cdef-fedc-ba9876543210");
+
+    CHECK(uint128(1, 3).to_string() == "00000000-0000-0001-0000-000000000003");
+  }
+
+  SUBCASE("std::hash") {
+    std::unordered_set<uint128> ids;
+    for(uint64_t i = 0; i < 1000; ++i) {
+      ids.insert(uint128(i, i));
+      ids.insert(uint128(0, i));
+    }
+
+    CHECK(ids.size() == 1999);
+    CHECK(ids.count(uint128(7, 7)) == 1);
+    CHECK(ids.count(uint128(7, 8)) == 0);
+  }
+}
+
+}
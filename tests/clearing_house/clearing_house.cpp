@@ -0,0 +1,213 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <doctest/doctest.h>
+
+#include <map>
+#include <memory>
+#include <vector>
+
+#include <book/ob.h>
+#include <book/plugins/routable.h>
+#include <clearing_house/clearing_house.h>
+
+#define BASE 3
+#define QUOTE 1
+#define FEES 0
+#define USER_1 1
+#define USER_2 2
+#define USER_3 3
+#define MM_1 1000
+#define MM_2 1001
+#define EXCHANGE_1 2
+#define EXCHANGE_2 3
+
+#define BUY true
+#define SELL false
+
+using clearing_house::ClearingHouse;
+using clearing_house::FeeSchedule;
+using clearing_house::FeeTier;
+using clearing_house::Settlement;
+
+const uint32_t SYMBOL_ID = utils::bqtos(BASE, QUOTE);
+
+struct Order {
+  uint64_t user_id_;
+  bool is_bid_;
+
+  uint64_t user_id() const { return user_id_; }
+  bool is_bid() const { return is_bid_; }
+};
+
+typedef std::shared_ptr<Order> OrderPtr;
+typedef book::Callback<OrderPtr> Callback;
+
+/* (user, asset) -> delta */
+std::map<std::pair<uint64_t, uint32_t>, double> by_user(
+  const std::vector<Settlement>& settlements)
+{
+  std::map<std::pair<uint64_t, uint32_t>, double> deltas;
+  for(auto& settlement : settlements)
+    deltas[std::make_pair(settlement.user_id, settlement.asset)] += settlement.delta;
+  return deltas;
+}
+
+
+TEST_CASE("clearing house") {
+  SUBCASE("fills are netted per user and asset") {
+    ClearingHouse house(4, FeeSchedule(std::vector<FeeTier>{ FeeTier{ 0, 0.01, 0 } }));
+
+    house.on_trade(SYMBOL_ID, USER_1, USER_2, BUY, 2, 100);
+    house.on_trade(SYMBOL_ID, USER_1, USER_2, BUY, 1, 110);
+    house.on_trade(SYMBOL_ID, USER_1, USER_3, SELL, 3, 100);
+
+    /* 3 users and the fee account, on 2 assets */
+    CHECK(house.pending() == 7);
+    CHECK(house.pending_delta(USER_2, BASE) == -3);
+
+    std::vector<Settlement> settlements;
+    CHECK(house.flush(settlements) == 6);
+
+    auto deltas = by_user(settlements);
+
+    /* user 1 bought and sold 3, netting to nothing in base */
+    CHECK(deltas.count(std::make_pair(USER_1, BASE)) == 0);
+    CHECK(deltas[std::make_pair(USER_1, QUOTE)] == doctest::Approx(-10 - 6.1));
+    CHECK(deltas[std::make_pair(USER_2, QUOTE)] == doctest::Approx(310));
+    CHECK(deltas[std::make_pair(USER_3, BASE)] == 3);
+    CHECK(deltas[std::make_pair(FEES, QUOTE)] == doctest::Approx(6.1));
+
+    double quote = 0;
+    for(auto& settlement : settlements)
+      if(settlement.asset == QUOTE) quote += settlement.delta;
+    CHECK(quote == doctest::Approx(0));
+
+    CHECK(house.pending() == 0);
+    CHECK(house.flush(settlements) == 0);
+  }
+
+  SUBCASE("fees and rebates follow volume tiers") {
+    ClearingHouse house(4, FeeSchedule(std::vector<FeeTier>{
+      FeeTier{ 1000, 0.002, -0.001 },
+      FeeTier{ 0, 0.003, 0.001 } }));
+
+    house.on_trade(SYMBOL_ID, USER_1, USER_2, BUY, 10, 100);
+    CHECK(house.tier(USER_1) == 1);
+    CHECK(house.volume(USER_2) == 1000);
+
+    /* charged at the first tier, before reaching the second */
+    CHECK(house.pending_delta(USER_1, QUOTE) == doctest::Approx(-1000 - 3));
+    CHECK(house.pending_delta(USER_2, QUOTE) == doctest::Approx(1000 - 1));
+
+    house.on_trade(SYMBOL_ID, USER_1, USER_2, BUY, 10, 100);
+    CHECK(house.pending_delta(USER_1, QUOTE) == doctest::Approx(-2000 - 3 - 2));
+    CHECK(house.pending_delta(USER_2, QUOTE) == doctest::Approx(2000 - 1 + 1));
+    CHECK(house.pending_delta(FEES, QUOTE) == doctest::Approx(3 + 1 + 2 - 1));
+  }
+
+  SUBCASE("the default schedule uses the book's rates") {
+    ClearingHouse house(4);
+    house.on_trade(SYMBOL_ID, USER_1, USER_2, SELL, 1, 100);
+
+    CHECK(house.pending_delta(USER_1, QUOTE) ==
+      doctest::Approx(100 * (1 - book::TAKER_FEE_RATE)));
+    CHECK(house.pending_delta(USER_2, QUOTE) ==
+      doctest::Approx(-100 * (1 + book::MAKER_FEE_RATE)));
+  }
+
+  SUBCASE("trades are taken from callbacks") {
+    ClearingHouse house(4, FeeSchedule(std::vector<FeeTier>{ FeeTier{ 0, 0, 0 } }));
+
+    OrderPtr taker = std::make_shared<Order>(Order{ USER_1, BUY });
+    OrderPtr maker_1 = std::make_shared<Order>(Order{ USER_2, SELL });
+    OrderPtr maker_2 = std::make_shared<Order>(Order{ USER_3, SELL });
+
+    std::vector<Callback> callbacks;
+    callbacks.push_back(Callback::fill(taker, maker_1, 1, 100, 100, 100, 1, 1, 0));
+    callbacks.push_back(Callback::level_fill(taker, 3, 101, 100.75, 4, 0, 0, 2));
+    callbacks.push_back(Callback::book_update());
+
+    std::vector<book::MakerFill<OrderPtr>> maker_fills{
+      book::MakerFill<OrderPtr>{ maker_1, 1 },
+      book::MakerFill<OrderPtr>{ maker_2, 2 } };
+
+    CHECK(house.on_callbacks(SYMBOL_ID, callbacks, maker_fills) == 3);
+
+    CHECK(house.pending_delta(USER_1, BASE) == 4);
+    CHECK(house.pending_delta(USER_1, QUOTE) == doctest::Approx(-403));
+    CHECK(house.pending_delta(USER_2, BASE) == -2);
+    CHECK(house.pending_delta(USER_3, QUOTE) == doctest::Approx(202));
+  }
+
+  SUBCASE("assets are bounded") {
+    ClearingHouse house(2);
+    house.on_trade(SYMBOL_ID, USER_1, USER_2, BUY, 1, 100);
+
+    CHECK_THROWS_AS(house.on_trade(utils::bqtos(BASE + 1, QUOTE),
+      USER_1, USER_2, BUY, 1, 100), std::runtime_error);
+  }
+}
+
+
+/* an order of a book routing to market makers */
+struct RoutedOrder {
+  uint64_t user;
+  bool bid;
+  double limit_price;
+  double quantity;
+  utils::uint128 id;
+
+  bool is_bid() const { return bid; }
+  double qty() const { return quantity; }
+  double price() const { return limit_price; }
+  double funds() const { return 0; }
+  utils::uint128 order_id() const { return id; }
+  uint64_t user_id() const { return user; }
+};
+
+typedef book::ComposeTracker<const RoutedOrder*,
+  book::plugins::RoutableTracker> RoutedTracker;
+
+/* settles its callbacks. routing to the second exchange fails */
+class RoutedBook : public book::OB<RoutedTracker,
+  book::plugins::RoutablePlugin<RoutedTracker>>
+{
+public:
+  RoutedBook(ClearingHouse& house) : OB(SYMBOL_ID), house_(house) {
+    register_market_maker(MM_1, EXCHANGE_1);
+    register_market_maker(MM_2, EXCHANGE_2);
+  }
+
+protected:
+  void on_callbacks(const Callbacks& callbacks) {
+    house_.on_callbacks(symbol_id(), callbacks, maker_fills());
+  }
+
+  void on_routing_request(const RoutingRequest& request) {
+    if(request.exchange_id == EXCHANGE_1)
+      on_routing_success(request.request_id);
+    else
+      on_routing_failure(request.request_id);
+  }
+
+private:
+  ClearingHouse& house_;
+};
+
+TEST_CASE("clearing routed fills") {
+  ClearingHouse house(4, FeeSchedule(std::vector<FeeTier>{ FeeTier{ 0, 0, 0 } }));
+  RoutedBook book(house);
+
+  RoutedOrder mm_1 = { MM_1, SELL, 1000, 1, utils::uint128(1, 1) };
+  RoutedOrder mm_2 = { MM_2, SELL, 2000, 1, utils::uint128(1, 2) };
+  RoutedOrder taker = { USER_1, BUY, 2000, 2, utils::uint128(1, 3) };
+
+  book.add(&mm_1);
+  book.add(&mm_2);
+  book.add(&taker);
+
+  /* matched against both market makers, only the first leg traded */
+  CHECK(house.pending_delta(USER_1, BASE) == 1);
+  CHECK(house.pending_delta(USER_1, QUOTE) == doctest::Approx(-1000));
+  CHECK(house.pending_delta(MM_1, BASE) == -1);
+  CHECK(house.pending_delta(MM_2, BASE) == 0);
+}
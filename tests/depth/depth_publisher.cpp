@@ -0,0 +1,89 @@
+#include <doctest/doctest.h>
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <unistd.h>
+
+#include <depth/depth.h>
+#include <depth/depth_publisher.h>
+
+typedef depth::Depth<5> SizedDepth;
+
+TEST_CASE("depth publisher") {
+  const std::string name = "/eigenbasis_test_depth_" + std::to_string(getpid());
+
+  depth::DepthPublisher<5, 3> publisher(name, 2);
+  depth::DepthReader<3> reader(name);
+
+  CHECK(reader.symbols() == 2);
+
+  depth::DepthSnapshot<3> snapshot;
+  CHECK(reader.read(0, snapshot) == 0);
+
+  SUBCASE("readers see the top levels, BBO and market price") {
+    SizedDepth depth;
+    depth.add_order(1000, 1, true);
+    depth.add_order(1000, 2, true);
+    depth.add_order(999, 1, true);
+    depth.add_order(1010, 4, false);
+
+    publisher.publish(1, 42, depth, 1005);
+
+    CHECK(reader.version(0) == 0);
+    CHECK(reader.version(1) == 1);
+    CHECK(reader.read(1, snapshot) == 1);
+
+    CHECK(snapshot.symbol_id == 42);
+    CHECK(snapshot.market_price == 1005);
+    CHECK(snapshot.ts != 0);
+    CHECK(snapshot.bid_price == 1000);
+    CHECK(snapshot.bid_qty == 3);
+    CHECK(snapshot.ask_price == 1010);
+    CHECK(snapshot.ask_qty == 4);
+
+    CHECK(snapshot.bids[0].order_count == 2);
+    CHECK(snapshot.bids[1].price == 999);
+    CHECK(snapshot.bids[2].price == 0);
+    CHECK(snapshot.asks[1].price == 0);
+  }
+
+  SUBCASE("snapshots are consistent while the writer publishes") {
+    std::atomic<bool> done(false);
+
+    /* every level of a publication holds the same qty */
+    std::thread writer([&]() {
+      for(int i = 1; i <= 20000; ++i) {
+        SizedDepth depth;
+        for(int level = 0; level < 5; ++level) {
+          depth.add_order(1000 - level, i, true);
+          depth.add_order(1001 + level, i, false);
+        }
+        publisher.publish(0, 1, depth, i);
+      }
+      done = true;
+    });
+
+    size_t reads = 0;
+    uint64_t last = 0;
+    while(!done || last < 20000) {
+      uint64_t version = reader.read(0, snapshot);
+      if(version == 0) continue;
+
+      bool consistent = snapshot.market_price == (double)version;
+      for(int level = 0; level < 3; ++level) {
+        consistent &= snapshot.bids[level].qty == snapshot.market_price;
+        consistent &= snapshot.asks[level].qty == snapshot.market_price;
+      }
+
+      REQUIRE(consistent);
+      REQUIRE(version >= last);
+      last = version;
+      ++reads;
+    }
+
+    writer.join();
+    CHECK(reads > 0);
+    CHECK(last == 20000);
+  }
+}
@@ -0,0 +1,210 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <doctest/doctest.h>
+
+#include <memory>
+#include <vector>
+
+#include <book/ob.h>
+#include <book/plugins/routable.h>
+#include <ohlc/ohlc.h>
+
+#define SYMBOL_ID_1 1
+#define SYMBOL_ID_2 2
+#define USER_1 1
+#define MM_1 1000
+#define MM_2 1001
+#define EXCHANGE_1 2
+#define EXCHANGE_2 3
+
+#define BUY true
+#define SELL false
+
+using ohlc::Candle;
+using ohlc::CandleSeries;
+using ohlc::NS_PER_SECOND;
+using ohlc::NS_PER_MINUTE;
+
+const uint64_t T0 = 1599999960ull * NS_PER_SECOND; /* a minute boundary */
+
+
+TEST_CASE("candle series") {
+  CandleSeries series(NS_PER_SECOND, 3);
+  CHECK(series.capacity() == 4);
+  CHECK(series.empty());
+
+  series.on_trade(T0 + 100, 10, 1);
+  series.on_trade(T0 + 200, 12, 1);
+  series.on_trade(T0 + 300, 9, 2);
+  series.on_trade(T0 + 400, 11, 1);
+
+  REQUIRE(series.size() == 1);
+  const Candle& candle = series.last();
+  CHECK(candle.open_ts == T0);
+  CHECK(candle.open == 10);
+  CHECK(candle.high == 12);
+  CHECK(candle.low == 9);
+  CHECK(candle.close == 11);
+  CHECK(candle.volume == 5);
+  CHECK(candle.trades == 4);
+  CHECK(candle.vwap() == doctest::Approx(51.0 / 5));
+
+  SUBCASE("a trade past the interval opens the next candle") {
+    series.on_trade(T0 + NS_PER_SECOND, 13, 1);
+    REQUIRE(series.size() == 2);
+    CHECK(series.last().open_ts == T0 + NS_PER_SECOND);
+    CHECK(series.last().open == 13);
+    CHECK(series.at(0).close == 11);
+  }
+
+  SUBCASE("intervals without trades have no candle") {
+    series.on_trade(T0 + 5 * NS_PER_SECOND + 1, 13, 1);
+    REQUIRE(series.size() == 2);
+    CHECK(series.last().open_ts == T0 + 5 * NS_PER_SECOND);
+  }
+
+  SUBCASE("late trades are counted in the last candle") {
+    series.on_trade(T0 + NS_PER_SECOND, 13, 1);
+    series.on_trade(T0 + 500, 8, 1);
+    REQUIRE(series.size() == 2);
+    CHECK(series.last().low == 8);
+    CHECK(series.at(0).low == 9);
+  }
+
+  SUBCASE("the oldest candles roll out") {
+    for(uint64_t i = 1; i <= 5; ++i)
+      series.on_trade(T0 + i * NS_PER_SECOND, 10 + i, 1);
+
+    REQUIRE(series.size() == 4);
+    CHECK(series.at(0).open_ts == T0 + 2 * NS_PER_SECOND);
+    CHECK(series.last().open_ts == T0 + 5 * NS_PER_SECOND);
+
+    /* across the wrap of the buffer */
+    Candle out[4];
+    REQUIRE(series.query(0, UINT64_MAX, out, 4) == 4);
+    for(uint64_t i = 0; i < 4; ++i)
+      CHECK(out[i].open_ts == T0 + (i + 2) * NS_PER_SECOND);
+
+    REQUIRE(series.query(T0 + 3 * NS_PER_SECOND, T0 + 5 * NS_PER_SECOND, out, 4) == 2);
+    CHECK(out[0].open == 13);
+    CHECK(out[1].open == 14);
+
+    CHECK(series.query(0, UINT64_MAX, out, 1) == 1);
+    CHECK(out[0].open_ts == T0 + 2 * NS_PER_SECOND);
+
+    CHECK(series.query(T0 + 9 * NS_PER_SECOND, UINT64_MAX, out, 4) == 0);
+  }
+}
+
+
+struct Order {};
+typedef std::shared_ptr<Order> OrderPtr;
+typedef book::Callback<OrderPtr> Callback;
+
+
+TEST_CASE("ohlc") {
+  ohlc::OHLC candles(
+    std::vector<uint64_t>{ NS_PER_SECOND, NS_PER_MINUTE }, 16);
+
+  candles.add_symbol(SYMBOL_ID_1);
+  CHECK(candles.has_symbol(SYMBOL_ID_1));
+  CHECK(!candles.has_symbol(SYMBOL_ID_2));
+
+  SUBCASE("trades update every interval") {
+    candles.on_trade(SYMBOL_ID_1, T0, 10, 1);
+    candles.on_trade(SYMBOL_ID_1, T0 + NS_PER_SECOND, 20, 1);
+    candles.on_trade(SYMBOL_ID_2, T0, 5, 1);
+
+    CHECK(candles.series(SYMBOL_ID_1, NS_PER_SECOND).size() == 2);
+    CHECK(candles.series(SYMBOL_ID_1, NS_PER_MINUTE).size() == 1);
+    CHECK(candles.series(SYMBOL_ID_1, NS_PER_MINUTE).last().vwap() == 15);
+    CHECK(candles.series(SYMBOL_ID_2, NS_PER_MINUTE).last().close == 5);
+
+    Candle out[4];
+    CHECK(candles.query(SYMBOL_ID_1, NS_PER_SECOND, T0, T0 + NS_PER_MINUTE, out, 4) == 2);
+    CHECK(out[1].open == 20);
+
+    CHECK_THROWS_AS(candles.series(SYMBOL_ID_1, 7 * NS_PER_SECOND), std::out_of_range);
+  }
+
+  SUBCASE("trades are taken from callbacks") {
+    std::vector<Callback> callbacks;
+    callbacks.push_back(Callback::fill(nullptr, nullptr, 2, 100, 100, 100, 2, 2, 0));
+    callbacks.push_back(Callback::level_fill(nullptr, 3, 101, 100.6, 5, 0, 0, 3));
+    callbacks.push_back(Callback::book_update());
+
+    CHECK(candles.on_callbacks(SYMBOL_ID_1, callbacks) == 4);
+
+    const Candle& candle = candles.series(SYMBOL_ID_1, NS_PER_SECOND).last();
+    CHECK(candle.open == 100);
+    CHECK(candle.close == 101);
+    CHECK(candle.volume == 5);
+    CHECK(candle.trades == 4);
+    CHECK(candle.vwap() == doctest::Approx(100.6));
+  }
+}
+
+
+/* an order of a book routing to market makers */
+struct RoutedOrder {
+  uint64_t user;
+  bool bid;
+  double limit_price;
+  double quantity;
+  utils::uint128 id;
+
+  bool is_bid() const { return bid; }
+  double qty() const { return quantity; }
+  double price() const { return limit_price; }
+  double funds() const { return 0; }
+  utils::uint128 order_id() const { return id; }
+  uint64_t user_id() const { return user; }
+};
+
+typedef book::ComposeTracker<const RoutedOrder*,
+  book::plugins::RoutableTracker> RoutedTracker;
+
+/* counts its trades. routing to the second exchange fails */
+class RoutedBook : public book::OB<RoutedTracker,
+  book::plugins::RoutablePlugin<RoutedTracker>>
+{
+public:
+  RoutedBook(ohlc::OHLC& candles) : OB(SYMBOL_ID_1), candles_(candles) {
+    register_market_maker(MM_1, EXCHANGE_1);
+    register_market_maker(MM_2, EXCHANGE_2);
+  }
+
+protected:
+  void on_callbacks(const Callbacks& callbacks) {
+    candles_.on_callbacks(symbol_id(), callbacks);
+  }
+
+  void on_routing_request(const RoutingRequest& request) {
+    if(request.exchange_id == EXCHANGE_1)
+      on_routing_success(request.request_id);
+    else
+      on_routing_failure(request.request_id);
+  }
+
+private:
+  ohlc::OHLC& candles_;
+};
+
+TEST_CASE("ohlc of routed trades") {
+  ohlc::OHLC candles(std::vector<uint64_t>{ ohlc::NS_PER_DAY }, 4);
+  RoutedBook book(candles);
+
+  RoutedOrder mm_1 = { MM_1, SELL, 1000, 1, utils::uint128(1, 1) };
+  RoutedOrder mm_2 = { MM_2, SELL, 2000, 1, utils::uint128(1, 2) };
+  RoutedOrder taker = { USER_1, BUY, 2000, 2, utils::uint128(1, 3) };
+
+  book.add(&mm_1);
+  book.add(&mm_2);
+  book.add(&taker);
+
+  /* matched against both market makers, only the first leg traded */
+  const Candle& candle = candles.series(SYMBOL_ID_1, ohlc::NS_PER_DAY).last();
+  CHECK(candle.trades == 1);
+  CHECK(candle.volume == 1);
+  CHECK(candle.high == 1000);
+  CHECK(candle.vwap() == 1000);
+}
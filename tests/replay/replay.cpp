@@ -0,0 +1,194 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <doctest/doctest.h>
+
+#include <map>
+#include <memory>
+#include <random>
+#include <atomic>
+#include <vector>
+#include <stdexcept>
+
+#include <book/ob.h>
+#include <book/plugins/self_trade_policy.h>
+#include <replay/replay.h>
+#include <utils/thread_pool.h>
+
+namespace replay_test {
+
+struct Order {
+  Order(uint32_t user_id, bool is_bid, double price, double qty, uint64_t order_id) :
+    user_id_(user_id), is_bid_(is_bid), price_(price), qty_(qty), order_id_(order_id) {}
+
+  uint64_t order_id() const { return order_id_; }
+  uint32_t user_id() const { return user_id_; }
+  bool is_bid() const { return is_bid_; }
+  double qty() const { return qty_; }
+  double price() const { return price_; }
+  double funds() const { return 0; }
+  book::plugins::SelfTradePolicy stp() const { return book::plugins::stp_cancel_taker; }
+
+  uint32_t user_id_;
+  bool is_bid_;
+  double price_;
+  double qty_;
+  uint64_t order_id_;
+};
+
+typedef std::shared_ptr<Order> OrderPtr;
+
+typedef book::ComposeTracker<OrderPtr,
+  book::plugins::SelfTradePolicyTracker> Tracker;
+
+typedef book::OB<
+  Tracker,
+  book::plugins::SelfTradePolicyPlugin<Tracker>
+> Book;
+
+typedef replay::Replay<Book> Replay;
+
+const uint32_t SYMBOLS = 7;
+
+std::vector<Replay::Command> order_flow(size_t size) {
+  std::mt19937_64 rng(11);
+  std::vector<Replay::Command> commands;
+  std::vector<std::vector<OrderPtr>> resting(SYMBOLS);
+
+  for(size_t i = 0; i < size; ++i) {
+    /* symbols of uneven activity */
+    uint32_t symbol_id = (uint32_t)((rng() % (SYMBOLS * SYMBOLS)) % SYMBOLS) + 1;
+    auto& orders = resting[symbol_id - 1];
+
+    int action = rng() % 10;
+    if(action < 7 || orders.empty()) {
+      bool is_bid = rng() % 2;
+      double price = 100 + (double)(rng() % 20) - (is_bid ? 5 : -5) * (action == 0 ? -1 : 1);
+      OrderPtr order = std::make_shared<Order>(
+        (uint32_t)(rng() % 4), is_bid, price, 1 + (double)(rng() % 5), i);
+
+      commands.push_back(Replay::Command::add_order(symbol_id, order));
+      orders.push_back(order);
+    }
+    else {
+      OrderPtr order = orders[rng() % orders.size()];
+      if(action < 9)
+        commands.push_back(Replay::Command::cancel_order(symbol_id, order));
+      else
+        commands.push_back(Replay::Command::replace_order(symbol_id, order, 1));
+    }
+  }
+
+  return commands;
+}
+
+/* one book per symbol, commands applied in stream order */
+class Recorder : public Book {
+public:
+  Recorder(uint32_t symbol_id, Replay::Result& result, uint64_t& seq) :
+    Book(symbol_id), result_(result), seq_(seq) {}
+
+protected:
+  void on_callbacks(const Callbacks& callbacks) {
+    for(auto& cb : callbacks) {
+      result_.outputs.push_back(replay::Output<OrderPtr>{ seq_, cb });
+      result_.outputs.back().callback.ts = 0;
+    }
+  }
+
+private:
+  Replay::Result& result_;
+  uint64_t& seq_;
+};
+
+void check_same(const Replay::Result& a, const Replay::Result& b) {
+  REQUIRE(a.outputs.size() == b.outputs.size());
+
+  for(size_t i = 0; i < a.outputs.size(); ++i) {
+    auto& x = a.outputs[i];
+    auto& y = b.outputs[i];
+
+    CHECK(x.seq == y.seq);
+    CHECK(x.callback.type == y.callback.type);
+    CHECK(x.callback.order == y.callback.order);
+    CHECK(x.callback.maker_order == y.callback.maker_order);
+    CHECK(x.callback.qty == y.callback.qty);
+    CHECK(x.callback.price == y.callback.price);
+    CHECK(x.callback.avg_price == y.callback.avg_price);
+    CHECK(x.callback.flags == y.callback.flags);
+    CHECK(x.callback.reason == y.callback.reason);
+  }
+}
+
+
+TEST_CASE("sharded replay") {
+  std::vector<Replay::Command> commands = order_flow(5000);
+
+  Replay::Result expected;
+  uint64_t seq = 0;
+  std::map<uint32_t, std::unique_ptr<Recorder>> books;
+
+  for(; seq < commands.size(); ++seq) {
+    auto& command = commands[seq];
+    auto& book = books[command.symbol_id];
+    if(!book) book.reset(new Recorder(command.symbol_id, expected, seq));
+
+    switch(command.type) {
+      case Replay::Command::add:
+        book->add(command.order); break;
+      case Replay::Command::cancel:
+        book->cancel(command.order, command.reason); break;
+      case Replay::Command::replace:
+        book->replace(command.order, command.delta); break;
+    }
+  }
+
+  size_t trades = 0;
+  for(auto& output : expected.outputs)
+    if(output.callback.type == Book::TypedCallback::cb_trade) ++trades;
+  CHECK(trades > 100);
+
+  SUBCASE("on the caller's thread") {
+    check_same(Replay::run(commands, 0), expected);
+  }
+
+  SUBCASE("on a pool") {
+    check_same(Replay::run(commands, 4), expected);
+    check_same(Replay::run(commands, 16), expected);
+  }
+}
+
+
+TEST_CASE("thread pool") {
+  utils::ThreadPool pool(4);
+  std::atomic<size_t> ran(0);
+
+  SUBCASE("a task that throws is rethrown by wait()") {
+    for(size_t i = 0; i < 100; ++i)
+      pool.submit([i, &ran]() {
+        if(i == 50) throw std::runtime_error("task failed");
+        ++ran;
+      });
+
+    CHECK_THROWS_AS(pool.wait(), std::runtime_error);
+    CHECK(ran == 99);
+
+    /* the workers carry on, and the exception is reported once */
+    pool.submit([&ran]() { ++ran; });
+    pool.wait();
+    CHECK(ran == 100);
+  }
+
+  SUBCASE("a worker runs its own tasks in submission order") {
+    utils::ThreadPool single(1);
+    std::vector<size_t> order;
+
+    for(size_t i = 0; i < 10; ++i)
+      single.submit([i, &order]() { order.push_back(i); });
+    single.wait();
+
+    REQUIRE(order.size() == 10);
+    for(size_t i = 0; i < 10; ++i)
+      CHECK(order[i] == i);
+  }
+}
+
+}